@@ -1,13 +1,30 @@
+#define _GNU_SOURCE         // Expose pipe2 and O_CLOEXEC
 #include <stdio.h>      // Standard I/O functions (e.g., printf, fgets)
 #include <stdlib.h>     // Standard library functions (e.g., getenv, exit)
 #include <string.h>     // String manipulation functions (e.g., strtok, strcpy)
 #include <unistd.h>     // UNIX standard functions (e.g., fork, execvp, chdir)
 #include <sys/wait.h>   // Wait for process termination (e.g., wait)
+#include <fcntl.h>      // File descriptor flags (e.g., O_CLOEXEC)
+#include <spawn.h>      // Lightweight process creation (e.g., posix_spawn)
+#include <sys/stat.h>   // File status (e.g., stat, for PATH directory mtimes)
+#include <sys/mman.h>   // Memory mapping (e.g., mmap, for loading history)
+#include <stdint.h>     // Fixed width integers (e.g., uint32_t)
+#include <errno.h>      // Error numbers (e.g., EINTR)
+#include <time.h>       // Monotonic clock (e.g., clock_gettime)
+#include <sys/resource.h>  // Resource usage of children (e.g., wait4, struct rusage)
+
+extern char** environ;  // Environment passed on to spawned commands
 
 
 #define MAX_INPUT_LENGTH 2048  // Maximum length of user input
-#define HISTORY_SIZE 2048      // Size of the command history
+#define HISTORY_SIZE 2048      // Maximum number of commands kept in history
+#define HISTORY_FILE ".mtl458_history"  // History file in $HOME, overridden by $MTL458_HISTFILE
+#define HISTORY_MAGIC "MTLHIST1"        // Header identifying a history file
+#define HISTORY_MAGIC_LEN 8
 #define MAX_ARGS 100            // Maximum number of arguments for a command
+#define PATH_CACHE_SIZE 256     // Number of buckets in the command path cache
+#define DEFAULT_PATH "/bin:/usr/bin"  // Search path used when PATH is unset
+#define BATCH_CHUNK_SIZE 65536  // Bytes read at a time from a script in batch mode
 
 
 // Greeting shell interface on starting
@@ -20,23 +37,339 @@ void init_shell()
     printf("\n\t************************************************************\n");
 }
 
-// Array to store command history
-char history[HISTORY_SIZE][MAX_INPUT_LENGTH];
-int history_count = 0;  // Counter for the number of commands in history
+// Location of one command inside the history arena
+typedef struct {
+    size_t offset;  // Start of the command in history_arena
+    size_t length;  // Length of the command, without the terminator
+} history_entry_t;
+
+// Commands are stored back to back (NUL-terminated) in one growable arena. Since they
+// are evicted oldest first, the live ones always form the window
+// [history_arena_start, history_arena_used), so memory follows what is actually stored.
+char* history_arena = NULL;
+size_t history_arena_start = 0;  // Offset of the oldest live command
+size_t history_arena_used = 0;   // Bytes of the arena in use
+size_t history_arena_cap = 0;    // Bytes allocated for the arena
+
+// Ring of live commands; command number seq lives at seq % history_capacity.
+// The ring only grows before it first wraps, so the mapping never changes under it.
+history_entry_t* history_entries = NULL;
+int history_capacity = 0;  // Grows up to HISTORY_SIZE
+int history_count = 0;     // Number of commands added since start or the last clear
+int history_first = 0;     // Number of the oldest command still stored
+
+int history_fd = -1;  // Append-only history file, -1 if history is not persisted
+
+// Posting list of the commands containing one trigram, used by history -s
+typedef struct {
+    unsigned int key;  // Three packed characters, 0 for an empty slot
+    int* seqs;         // Ascending command numbers containing the trigram
+    int start;         // First entry of seqs that may still be live
+    int len;           // Number of entries used in seqs
+    int cap;           // Number of entries allocated in seqs
+} trigram_posting_t;
+
+trigram_posting_t* trigram_table = NULL;  // Open addressing table of posting lists
+int trigram_slots = 0;                    // Power of two
+int trigram_used = 0;
+
+// Function to pack the trigram starting at p; never 0 since commands contain no NUL
+unsigned int trigram_key(const char* p) {
+    return ((unsigned int)(unsigned char)p[0] << 16) | ((unsigned int)(unsigned char)p[1] << 8) | (unsigned char)p[2];
+}
+
+// Function to find the slot of a trigram, or the empty slot where it would go
+trigram_posting_t* trigram_slot(unsigned int key) {
+    unsigned int mask = (unsigned int)trigram_slots - 1;
+    unsigned int i = (key * 2654435761u) & mask;
+    while (trigram_table[i].key != 0 && trigram_table[i].key != key) {
+        i = (i + 1) & mask;
+    }
+    return &trigram_table[i];
+}
+
+// Function to double the trigram table once it is 70% full
+void trigram_grow() {
+    trigram_posting_t* old = trigram_table;
+    int old_slots = trigram_slots;
+    trigram_slots = old_slots ? old_slots * 2 : 1024;
+    trigram_table = calloc(trigram_slots, sizeof(trigram_posting_t));
+    for (int i = 0; i < old_slots; i++) {
+        if (old[i].key != 0) {
+            *trigram_slot(old[i].key) = old[i];
+        }
+    }
+    free(old);
+}
+
+// Function to drop evicted commands from the front of a posting list
+void trigram_trim(trigram_posting_t* posting) {
+    while (posting->start < posting->len && posting->seqs[posting->start] < history_first) {
+        posting->start++;
+    }
+    // Reclaim the dead prefix once it is more than half of the list
+    if (posting->start > posting->len / 2) {
+        posting->len -= posting->start;
+        memmove(posting->seqs, posting->seqs + posting->start, posting->len * sizeof(int));
+        posting->start = 0;
+    }
+}
+
+// Function to index every trigram of a newly stored command
+void trigram_index(const char* command, size_t length, int seq) {
+    for (size_t i = 0; i + 3 <= length; i++) {
+        if (trigram_used * 10 >= trigram_slots * 7) {
+            trigram_grow();
+        }
+        unsigned int key = trigram_key(command + i);
+        trigram_posting_t* posting = trigram_slot(key);
+        if (posting->key == 0) {
+            posting->key = key;
+            trigram_used++;
+        }
+        if (posting->len > 0 && posting->seqs[posting->len - 1] == seq) {
+            continue;  // Trigram repeated inside the same command
+        }
+        trigram_trim(posting);
+        if (posting->len == posting->cap) {
+            posting->cap = posting->cap ? posting->cap * 2 : 4;
+            posting->seqs = realloc(posting->seqs, posting->cap * sizeof(int));
+        }
+        posting->seqs[posting->len++] = seq;
+    }
+}
+
+// Function to get the text of a stored command by its number
+const char* history_text(int seq) {
+    return history_arena + history_entries[seq % history_capacity].offset;
+}
+
+// Function to store a command in the in-memory history, evicting the oldest if full
+void history_store(const char* command, size_t length) {
+    if (history_count - history_first == history_capacity) {
+        if (history_capacity < HISTORY_SIZE) {
+            // Not wrapped yet, so growing keeps every command at its index
+            history_capacity = history_capacity ? history_capacity * 2 : 64;
+            if (history_capacity > HISTORY_SIZE) history_capacity = HISTORY_SIZE;
+            history_entries = realloc(history_entries, history_capacity * sizeof(history_entry_t));
+        } else {
+            // Evict the oldest command; its bytes become the dead prefix of the arena
+            history_first++;
+            history_arena_start = history_entries[history_first % history_capacity].offset;
+        }
+    }
+
+    if (history_arena_used + length + 1 > history_arena_cap) {
+        if (history_arena_start > history_arena_used / 2) {
+            // Slide the live window back to the front instead of growing
+            size_t live = history_arena_used - history_arena_start;
+            memmove(history_arena, history_arena + history_arena_start, live);
+            for (int seq = history_first; seq < history_count; seq++) {
+                history_entries[seq % history_capacity].offset -= history_arena_start;
+            }
+            history_arena_used = live;
+            history_arena_start = 0;
+        }
+        while (history_arena_used + length + 1 > history_arena_cap) {
+            history_arena_cap = history_arena_cap ? history_arena_cap * 2 : 4096;
+        }
+        history_arena = realloc(history_arena, history_arena_cap);
+    }
+
+    history_entry_t* entry = &history_entries[history_count % history_capacity];
+    entry->offset = history_arena_used;
+    entry->length = length;
+    memcpy(history_arena + history_arena_used, command, length);
+    history_arena[history_arena_used + length] = '\0';
+    history_arena_used += length + 1;
+
+    trigram_index(command, length, history_count);
+    history_count++;
+}
+
+// Function to forget every stored command
+void clear_history_memory() {
+    for (int i = 0; i < trigram_slots; i++) {
+        free(trigram_table[i].seqs);
+    }
+    free(trigram_table);
+    free(history_entries);
+    free(history_arena);
+    trigram_table = NULL;
+    trigram_slots = trigram_used = 0;
+    history_entries = NULL;
+    history_capacity = history_count = history_first = 0;
+    history_arena = NULL;
+    history_arena_start = history_arena_used = history_arena_cap = 0;
+}
+
+// Function to append one record (32-bit length, then the text) to the history file
+// A single write on an O_APPEND descriptor keeps records of concurrent shells whole.
+void history_write_record(int fd, const char* command, size_t length) {
+    char record[sizeof(uint32_t) + MAX_INPUT_LENGTH];
+    uint32_t len32 = (uint32_t)length;
+    if (length > MAX_INPUT_LENGTH) return;
+    memcpy(record, &len32, sizeof(len32));
+    memcpy(record + sizeof(len32), command, length);
+    if (write(fd, record, sizeof(len32) + length) < 0) {
+        perror("history");
+    }
+}
+
+// Function to rewrite the history file with only the commands currently stored
+// The new file is written next to the old one and renamed over it.
+void rewrite_history_file(const char* path) {
+    char tmp_path[MAX_INPUT_LENGTH];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    if (write(fd, HISTORY_MAGIC, HISTORY_MAGIC_LEN) < 0) {
+        close(fd);
+        return;
+    }
+    for (int seq = history_first; seq < history_count; seq++) {
+        history_write_record(fd, history_text(seq), history_entries[seq % history_capacity].length);
+    }
+    if (rename(tmp_path, path) != 0) {
+        close(fd);
+        unlink(tmp_path);
+        return;
+    }
+    if (history_fd >= 0) close(history_fd);
+    history_fd = fd;
+}
+
+// Function to get the path of the history file, NULL if history is not persisted
+const char* history_file_path() {
+    static char path[MAX_INPUT_LENGTH];
+    const char* file = getenv("MTL458_HISTFILE");
+    if (file != NULL) return file;
+    const char* home = getenv("HOME");
+    if (home == NULL) return NULL;
+    snprintf(path, sizeof(path), "%s/%s", home, HISTORY_FILE);
+    return path;
+}
+
+// Function to load the history file into memory
+// The file is mapped and walked record by record through the length prefixes; only the
+// last HISTORY_SIZE records are copied, and a file holding many more is compacted.
+void load_history() {
+    const char* path = history_file_path();
+    if (path == NULL) return;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return;
+    }
+    if (st.st_size == 0) {
+        // Fresh file, start it with the magic header
+        if (write(fd, HISTORY_MAGIC, HISTORY_MAGIC_LEN) == HISTORY_MAGIC_LEN) {
+            history_fd = fd;
+        } else {
+            close(fd);
+        }
+        return;
+    }
+
+    size_t size = (size_t)st.st_size;
+    char* data = (size >= HISTORY_MAGIC_LEN) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    if (data == MAP_FAILED || memcmp(data, HISTORY_MAGIC, HISTORY_MAGIC_LEN) != 0) {
+        // Not a history file written by this shell, leave it untouched
+        if (data != MAP_FAILED) munmap(data, size);
+        close(fd);
+        return;
+    }
+    history_fd = fd;
+
+    // Remember where the last HISTORY_SIZE records start
+    size_t* starts = malloc(HISTORY_SIZE * sizeof(size_t));
+    long records = 0;
+    size_t pos = HISTORY_MAGIC_LEN;
+    while (pos + sizeof(uint32_t) <= size) {
+        uint32_t len32;
+        memcpy(&len32, data + pos, sizeof(len32));
+        if (len32 > MAX_INPUT_LENGTH || pos + sizeof(len32) + len32 > size) {
+            break;  // Truncated or corrupt tail
+        }
+        starts[records % HISTORY_SIZE] = pos;
+        records++;
+        pos += sizeof(len32) + len32;
+    }
+
+    long first = (records > HISTORY_SIZE) ? records - HISTORY_SIZE : 0;
+    for (long r = first; r < records; r++) {
+        size_t start = starts[r % HISTORY_SIZE];
+        uint32_t len32;
+        memcpy(&len32, data + start, sizeof(len32));
+        history_store(data + start + sizeof(len32), len32);
+    }
+    free(starts);
+    munmap(data, size);
+
+    if (records > 2 * HISTORY_SIZE || pos != size) {
+        rewrite_history_file(path);
+    }
+}
 
 // Function to add a command to history
 void add_to_history(const char* command) {
-    // Copy the command to the history array at the current index, wrapping around if needed
-    strncpy(history[history_count % HISTORY_SIZE], command, MAX_INPUT_LENGTH);
-    history_count++;  // Increment history counter
+    size_t length = strlen(command);
+    history_store(command, length);
+    if (history_fd >= 0) {
+        history_write_record(history_fd, command, length);
+    }
+}
+
+// Function to clear the command history, both in memory and on disk
+void clear_history() {
+    clear_history_memory();
+    const char* path = history_file_path();
+    if (history_fd >= 0 && path != NULL) {
+        rewrite_history_file(path);
+    }
 }
 
 // Function to display the command history
 void show_history(int limit) {
-    // Calculate the starting index for displaying history
-    int start = (history_count > limit) ? history_count - limit : 0;
-    for (int i = start; i < history_count; i++) {
-        printf("%s\n", history[i]);  // Print each command
+    // Calculate the starting command, never going past the oldest one still stored
+    int start = (history_count - history_first > limit) ? history_count - limit : history_first;
+    for (int seq = start; seq < history_count; seq++) {
+        printf("%s\n", history_text(seq));  // Print each command
+    }
+}
+
+// Function to display the stored commands containing a pattern
+// Patterns of three or more characters only check the commands in the shortest
+// posting list among the pattern's trigrams; shorter patterns scan the history.
+void search_history(const char* pattern) {
+    size_t length = strlen(pattern);
+    if (length < 3) {
+        for (int seq = history_first; seq < history_count; seq++) {
+            if (strstr(history_text(seq), pattern)) {
+                printf("%s\n", history_text(seq));
+            }
+        }
+        return;
+    }
+
+    trigram_posting_t* best = NULL;
+    for (size_t i = 0; i + 3 <= length; i++) {
+        if (trigram_slots == 0) return;
+        trigram_posting_t* posting = trigram_slot(trigram_key(pattern + i));
+        if (posting->key == 0) return;  // Some trigram never occurs, so nothing matches
+        trigram_trim(posting);
+        if (best == NULL || posting->len - posting->start < best->len - best->start) {
+            best = posting;
+        }
+    }
+    for (int i = best->start; i < best->len; i++) {
+        const char* text = history_text(best->seqs[i]);
+        if (strstr(text, pattern)) {
+            printf("%s\n", text);
+        }
     }
 }
 
@@ -74,7 +407,7 @@ int parse_command(char* input, char** args, const char* delimiter) {
     args[count] = NULL;
 
     // Remove surrounding quotes from arguments
-    if (strcmp(args[0], "echo") != 0) {
+    if (count > 0 && strcmp(args[0], "echo") != 0) {
     for (int i = 0; i < count; i++) {
         int len = strlen(args[i]);
         // If the argument starts and ends with a quote, remove the quotes
@@ -89,71 +422,232 @@ int parse_command(char* input, char** args, const char* delimiter) {
     return count;  // Return the number of arguments
 }
 
-// Function to handle built-in commands like cd, history, echo, and exit
-int handle_builtin_commands(char** args) {
-    if (strcmp(args[0], "cd") == 0) {
-        const char* path;
-        char expanded_path[MAX_INPUT_LENGTH];
-
-        if (args[1] == NULL || strcmp(args[1], "~") == 0) {
-            // Change to the home directory
-            path = getenv("HOME");
-        } else if (strcmp(args[1], "-") == 0) {
-            // Change to the previous directory
-            path = getenv("OLDPWD");
-            if (path != NULL) {
-                printf("%s\n", path);  // Print the previous directory path
-            } else {
-                printf("Invalid Command\n");
-                return 1;  // Indicate failure
-            }
+// Cached location of an external command, like the `hash` table of other shells
+typedef struct path_cache_entry {
+    char* name;                     // Command name as typed
+    char* path;                     // Resolved absolute path
+    size_t dir_len;                 // Length of the directory part of path
+    struct timespec dir_mtime;      // Directory mtime when the entry was resolved
+    struct path_cache_entry* next;  // Next entry in the same bucket
+} path_cache_entry;
+
+path_cache_entry* path_cache[PATH_CACHE_SIZE];
+char* path_cache_env = NULL;       // PATH value the cache was built against
+unsigned long path_cache_hits = 0;    // Lookups answered from the cache
+unsigned long path_cache_misses = 0;  // Lookups that had to scan PATH
+
+// Function to hash a command name into a path cache bucket (FNV-1a)
+unsigned int path_cache_bucket(const char* name) {
+    unsigned int hash = 2166136261u;
+    for (const char* p = name; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    return hash % PATH_CACHE_SIZE;
+}
+
+// Function to drop every cached command location
+void clear_path_cache() {
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        path_cache_entry* entry = path_cache[i];
+        while (entry != NULL) {
+            path_cache_entry* next = entry->next;
+            free(entry->name);
+            free(entry->path);
+            free(entry);
+            entry = next;
+        }
+        path_cache[i] = NULL;
+    }
+}
+
+// Function to print the cached command locations and the hit/miss counters
+void show_path_cache() {
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        for (path_cache_entry* entry = path_cache[i]; entry != NULL; entry = entry->next) {
+            printf("%s\t%s\n", entry->name, entry->path);
+        }
+    }
+    printf("cache hits: %lu, misses: %lu\n", path_cache_hits, path_cache_misses);
+}
+
+// Function to read the mtime of the directory part of a path
+int get_dir_mtime(const char* path, size_t dir_len, struct timespec* mtime) {
+    char dir[MAX_INPUT_LENGTH];
+    struct stat st;
+    if (dir_len >= sizeof(dir)) return -1;
+    memcpy(dir, path, dir_len);
+    dir[dir_len] = '\0';
+    if (stat(dir, &st) != 0) return -1;
+    *mtime = st.st_mtim;
+    return 0;
+}
+
+// Function to scan the directories of PATH for an executable with the given name
+// Returns a malloc'ed path and stores the length of its directory part, or NULL if not found.
+char* search_path(const char* name, const char* path_env, size_t* dir_len) {
+    char candidate[MAX_INPUT_LENGTH];
+    const char* dir = path_env;
+
+    while (1) {
+        const char* end = strchr(dir, ':');
+        size_t len = end ? (size_t)(end - dir) : strlen(dir);
+        struct stat st;
+
+        // An empty PATH component means the current directory
+        if (len == 0) {
+            snprintf(candidate, sizeof(candidate), "./%s", name);
+            len = 1;
         } else {
-            // Expand ~ to home directory if present
-            if (args[1][0] == '~' && (args[1][1] == '/' || args[1][1] == '\0')) {
-                snprintf(expanded_path, sizeof(expanded_path), "%s%s", getenv("HOME"), args[1] + 1);
-                path = expanded_path;
-            }
-            // Change to the specified directory
-            else{
-                path = args[1];
+            snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)len, dir, name);
+        }
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+            *dir_len = len;
+            return strdup(candidate);
+        }
+
+        if (end == NULL) break;
+        dir = end + 1;
+    }
+    return NULL;
+}
+
+// Function to resolve a command name to the path of its executable
+// Names containing a '/' are used as they are. Otherwise the cache is consulted; the
+// whole cache is dropped when PATH changes, and an entry is re-resolved when the
+// directory it was found in has been modified since.
+const char* resolve_command(const char* name) {
+    if (strchr(name, '/')) {
+        return name;
+    }
+
+    const char* path_env = getenv("PATH");
+    if (path_env == NULL) {
+        path_env = DEFAULT_PATH;
+    }
+    if (path_cache_env == NULL || strcmp(path_cache_env, path_env) != 0) {
+        clear_path_cache();
+        free(path_cache_env);
+        path_cache_env = strdup(path_env);
+    }
+
+    unsigned int bucket = path_cache_bucket(name);
+    path_cache_entry** link = &path_cache[bucket];
+    while (*link != NULL) {
+        path_cache_entry* entry = *link;
+        if (strcmp(entry->name, name) == 0) {
+            struct timespec mtime;
+            if (get_dir_mtime(entry->path, entry->dir_len, &mtime) == 0
+                    && mtime.tv_sec == entry->dir_mtime.tv_sec
+                    && mtime.tv_nsec == entry->dir_mtime.tv_nsec) {
+                path_cache_hits++;
+                return entry->path;
             }
+            // Directory changed, forget this entry and search again
+            *link = entry->next;
+            free(entry->name);
+            free(entry->path);
+            free(entry);
+            break;
         }
+        link = &entry->next;
+    }
 
-        if (path == NULL || chdir(path) != 0) {
-            // If path is NULL or chdir fails, print an error
-            printf("Invalid Command\n");
+    path_cache_misses++;
+    size_t dir_len;
+    char* path = search_path(name, path_env, &dir_len);
+    if (path == NULL) {
+        return NULL;  // Not found, nothing to cache
+    }
+
+    path_cache_entry* entry = malloc(sizeof(path_cache_entry));
+    entry->name = strdup(name);
+    entry->path = path;
+    entry->dir_len = dir_len;
+    if (get_dir_mtime(path, dir_len, &entry->dir_mtime) != 0) {
+        entry->dir_mtime.tv_sec = entry->dir_mtime.tv_nsec = 0;
+    }
+    entry->next = path_cache[bucket];
+    path_cache[bucket] = entry;
+    return entry->path;
+}
+
+// Function to change the current directory
+int builtin_cd(char** args) {
+    const char* path;
+    char expanded_path[MAX_INPUT_LENGTH];
+
+    if (args[1] == NULL || strcmp(args[1], "~") == 0) {
+        // Change to the home directory
+        path = getenv("HOME");
+    } else if (strcmp(args[1], "-") == 0) {
+        // Change to the previous directory
+        path = getenv("OLDPWD");
+        if (path != NULL) {
+            printf("%s\n", path);  // Print the previous directory path
         } else {
-            // Update the environment variables PWD and OLDPWD
-            const char* oldpwd = getenv("PWD");
-            if (oldpwd != NULL) {
-                setenv("OLDPWD", oldpwd, 1);  // Set OLDPWD to the current directory
-            }
-            char newpwd[MAX_INPUT_LENGTH];
-            if (getcwd(newpwd, sizeof(newpwd)) != NULL) {
-                setenv("PWD", newpwd, 1);  // Set PWD to the new directory
-            }
+            printf("Invalid Command\n");
+            return 1;  // Indicate failure
+        }
+    } else {
+        // Expand ~ to home directory if present
+        if (args[1][0] == '~' && (args[1][1] == '/' || args[1][1] == '\0')) {
+            snprintf(expanded_path, sizeof(expanded_path), "%s%s", getenv("HOME"), args[1] + 1);
+            path = expanded_path;
         }
-        return 1;  // Indicate that a built-in command was handled
-    } else if (strcmp(args[0], "history") == 0) {
-        if (args[1] != NULL) {
-            if (strcmp(args[1], "-c") == 0) {
-                // Clear the command history if '-c' option is provided
-                history_count = 0;
-            } else if (atoi(args[1]) > 0) {
-                // Display the command history with a limit
-                int limit = atoi(args[1]);
-                show_history(limit);
+        // Change to the specified directory
+        else{
+            path = args[1];
+        }
+    }
+
+    if (path == NULL || chdir(path) != 0) {
+        // If path is NULL or chdir fails, print an error
+        printf("Invalid Command\n");
+    } else {
+        // Update the environment variables PWD and OLDPWD
+        const char* oldpwd = getenv("PWD");
+        if (oldpwd != NULL) {
+            setenv("OLDPWD", oldpwd, 1);  // Set OLDPWD to the current directory
+        }
+        char newpwd[MAX_INPUT_LENGTH];
+        if (getcwd(newpwd, sizeof(newpwd)) != NULL) {
+            setenv("PWD", newpwd, 1);  // Set PWD to the new directory
+        }
+    }
+    return 1;  // Indicate that a built-in command was handled
+}
+
+// Function to display or clear the command history
+int builtin_history(char** args) {
+    if (args[1] != NULL) {
+        if (strcmp(args[1], "-c") == 0) {
+            // Clear the command history if '-c' option is provided
+            clear_history();
+        } else if (strcmp(args[1], "-s") == 0) {
+            // Search the command history for a pattern
+            if (args[2] != NULL) {
+                search_history(args[2]);
             } else {
-                // Invalid argument provided
                 printf("Invalid Command\n");
             }
+        } else if (atoi(args[1]) > 0) {
+            // Display the command history with a limit
+            int limit = atoi(args[1]);
+            show_history(limit);
         } else {
-            // Display the full command history if no argument is provided
-            show_history(HISTORY_SIZE);
+            // Invalid argument provided
+            printf("Invalid Command\n");
         }
-        return 1;
-    } else if (strcmp(args[0], "help") == 0) {
-    // Display help information
+    } else {
+        // Display the full command history if no argument is provided
+        show_history(HISTORY_SIZE);
+    }
+    return 1;
+}
+
+// Function to display help information
+int builtin_help(char** args) {
+    (void)args;
 
     printf("\n\t************************************************************\n");
     printf("\t\tMTL458 Shell by Priyal Jain - Available Commands\n\n");
@@ -163,6 +657,9 @@ int handle_builtin_commands(char** args) {
     printf("  cd [dir]        : Change the current directory to [dir]. \n\t\t\tUse 'cd -' or 'cd ..' to go to the previous directory. \n\t\t\tUse 'cd ~' or 'cd' to go to the home directory.\n");
     printf("  history [n]     : Display the last [n] commands in the command history.\n");
     printf("  history -c      : Clear the command history.\n");
+    printf("  history -s [text] : Display the commands in history containing [text].\n");
+    printf("  hash            : Show cached command locations and cache hits/misses.\n");
+    printf("  hash -r         : Forget all cached command locations.\n");
     printf("  exit            : Exit the shell.\n");
     printf("  help            : Display this help message.\n\n");
 
@@ -202,79 +699,495 @@ int handle_builtin_commands(char** args) {
     printf("  command1 | command2 : Pipe the output of command1 to command2.\n");
 
     printf("\n\t************************************************************\n");
-    
+
     return 1;
-} else if (strcmp(args[0], "exit") == 0) {
-        // Exit the shell
-        exit(0);
+}
+
+// Function to exit the shell
+int builtin_exit(char** args) {
+    (void)args;
+    exit(0);
+}
+
+// Function to show or reset the command path cache
+int builtin_hash(char** args) {
+    if (args[1] != NULL) {
+        if (strcmp(args[1], "-r") == 0) {
+            clear_path_cache();  // Forget all cached locations
+        } else {
+            printf("Invalid Command\n");
+        }
+        return 1;
+    }
+    show_path_cache();
+    return 1;
+}
+
+// Table of built-in commands and the functions implementing them
+typedef struct {
+    const char* name;
+    int (*handler)(char** args);
+} builtin_t;
+
+const builtin_t builtins[] = {
+    {"cd", builtin_cd},
+    {"history", builtin_history},
+    {"help", builtin_help},
+    {"exit", builtin_exit},
+    {"hash", builtin_hash},
+};
+
+#define NUM_BUILTINS (int)(sizeof(builtins) / sizeof(builtins[0]))
+#define BUILTIN_SLOTS 16  // Power of two, larger than NUM_BUILTINS
+
+// Slot table from the builtin hash to an entry of builtins[], filled once at startup
+const builtin_t* builtin_slots[BUILTIN_SLOTS];
+
+// Function to hash a command name into the builtin slot table
+// Length plus first and last character is collision-free for the current builtins,
+// so a lookup costs one probe and at most one strcmp.
+unsigned int builtin_hash_name(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0) return 0;
+    return (unsigned int)(len + (unsigned char)name[0] + (unsigned char)name[len - 1]) & (BUILTIN_SLOTS - 1);
+}
+
+// Function to fill the builtin slot table, probing linearly if a new builtin collides
+void init_builtins() {
+    for (int i = 0; i < NUM_BUILTINS; i++) {
+        unsigned int slot = builtin_hash_name(builtins[i].name);
+        while (builtin_slots[slot] != NULL) {
+            slot = (slot + 1) & (BUILTIN_SLOTS - 1);
+        }
+        builtin_slots[slot] = &builtins[i];
+    }
+}
+
+// Function to find the built-in command with the given name, NULL if there is none
+const builtin_t* find_builtin(const char* name) {
+    unsigned int slot = builtin_hash_name(name);
+    while (builtin_slots[slot] != NULL) {
+        if (strcmp(builtin_slots[slot]->name, name) == 0) {
+            return builtin_slots[slot];
+        }
+        slot = (slot + 1) & (BUILTIN_SLOTS - 1);
+    }
+    return NULL;
+}
+
+// Function to handle built-in commands like cd, history, help, hash and exit
+int handle_builtin_commands(char** args) {
+    const builtin_t* builtin = find_builtin(args[0]);
+    if (builtin == NULL) {
+        return 0;  // Indicate that this is not a built-in command
+    }
+    return builtin->handler(args);
+}
+
+// Function to start a command with the given stdin/stdout without waiting for it
+// External commands are resolved through the path cache and started with posix_spawn,
+// which glibc implements with a vfork-style clone, so the shell's page tables are never copied however large its image grows.
+// Built-in commands still need a real fork since they run shell code in the child.
+// Returns the pid of the child, or -1 if it could not be started.
+pid_t spawn_command(char** args, int in_fd, int out_fd) {
+    pid_t pid;
+
+    if (find_builtin(args[0]) != NULL) {
+        fflush(stdout);  // Do not let the child inherit pending shell output
+        pid = fork();
+        if (pid == 0) {
+            // In child process
+            if (in_fd != STDIN_FILENO) {
+                dup2(in_fd, STDIN_FILENO);  // Redirect input
+                close(in_fd);
+            }
+            if (out_fd != STDOUT_FILENO) {
+                dup2(out_fd, STDOUT_FILENO);  // Redirect output
+                close(out_fd);
+            }
+            handle_builtin_commands(args);
+            exit(0);
+        } else if (pid < 0) {
+            // Fork failed
+            printf("Invalid Command\n");
+        }
+        return pid;
+    }
+
+    // Every pipe is created with O_CLOEXEC, so only the dup'ed ends survive the exec
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (in_fd != STDIN_FILENO) {
+        posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
     }
-    return 0;  // Indicate that this is not a built-in command
+    if (out_fd != STDOUT_FILENO) {
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    }
+
+    const char* path = resolve_command(args[0]);
+    int err = path ? posix_spawn(&pid, path, &actions, NULL, args, environ) : -1;
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0) {
+        // Command not found or could not be executed
+        printf("Invalid Command\n");
+        return -1;
+    }
+    return pid;
 }
 
 // Function to execute a command in a new process
 void execute_command(char** args) {
-    pid_t pid = fork();  // Create a new process
-    if (pid == 0) {
-        // In child process
-        execvp(args[0], args);  // Replace the child process with the new command
-        // If execvp fails, print an error and exit
-        printf("Invalid Command\n");
-        exit(1);
-    } else if (pid > 0) {
-        // In parent process
-        wait(NULL);  // Wait for the child process to finish
-    } else {
-        // Fork failed
-        printf("Invalid Command\n");
+    pid_t pid = spawn_command(args, STDIN_FILENO, STDOUT_FILENO);  // Create a new process
+    if (pid > 0) {
+        waitpid(pid, NULL, 0);  // Wait for the child process to finish
     }
 }
 
-// Function to execute commands connected by pipes
-void execute_piped_commands(char* input) {
+// Function to start every stage of a pipeline without waiting for any of them
+// All stages run at once, so data streams through the pipeline and a stage writing
+// more than a pipe buffer cannot block forever. Returns the number of pids stored.
+int start_pipeline(char* input, pid_t* pids) {
     char* commands[MAX_ARGS];
     int num_pipes = parse_command(input, commands, "|");  // Split input by pipes
 
+    int num_pids = 0;
     int fd[2];
     int in_fd = STDIN_FILENO;  // Initial input file descriptor
 
     for (int i = 0; i < num_pipes; i++) {
-        pipe(fd);  // Create a pipe
-
-        pid_t pid = fork();  // Create a new process
-        if (pid == 0) {
-            // In child process
-            dup2(in_fd, STDIN_FILENO);  // Redirect input
-            if (i < num_pipes - 1) {
-                dup2(fd[1], STDOUT_FILENO);  // Redirect output
-            }
-            close(fd[0]);
-            close(fd[1]);
-            char* args[MAX_ARGS];
-            parse_command(commands[i], args, " ");
-            if (!handle_builtin_commands(args)) { //check if it's builtin command, if so execute it otherwise proceed
-                execvp(args[0], args);  // Execute the standard linux command
-                // If execvp fails, print an error and exit
+        int out_fd = STDOUT_FILENO;
+        if (i < num_pipes - 1) {
+            if (pipe2(fd, O_CLOEXEC) != 0) {  // Create a pipe to the next stage
                 printf("Invalid Command\n");
+                break;
+            }
+            out_fd = fd[1];
+        }
+
+        char* args[MAX_ARGS];
+        if (parse_command(commands[i], args, " ") > 0) {
+            pid_t pid = spawn_command(args, in_fd, out_fd);
+            if (pid > 0) {
+                pids[num_pids++] = pid;
             }
-            exit(1);
-        } else if (pid < 0) {
-            // Fork failed
-            printf("Invalid Command\n");
         } else {
-            // In parent process
-            close(fd[1]);  // Close the write end of the pipe
+            printf("Invalid Command\n");
+        }
+
+        // In parent process, drop the ends now owned by the children
+        if (in_fd != STDIN_FILENO) {
+            close(in_fd);
+        }
+        if (out_fd != STDOUT_FILENO) {
+            close(out_fd);  // Close the write end so the reader sees EOF
             in_fd = fd[0];  // Update input file descriptor for next command
-            wait(NULL);  // Wait for the child process to finish
         }
     }
+    if (in_fd != STDIN_FILENO) {
+        close(in_fd);
+    }
+    return num_pids;
+}
+
+// Function to execute commands connected by pipes
+void execute_piped_commands(char* input) {
+    pid_t pids[MAX_ARGS];
+    int num_pids = start_pipeline(input, pids);
+
+    // Reap all stages together once the whole pipeline is running
+    for (int i = 0; i < num_pids; i++) {
+        waitpid(pids[i], NULL, 0);
+    }
+}
+
+// Resource usage of one command line run in batch mode
+typedef struct {
+    char* command;     // Text of the command line
+    double wall_ms;    // Time from start until the last process was reaped
+    double user_ms;    // User CPU time summed over all its processes
+    double sys_ms;     // System CPU time summed over all its processes
+    long max_rss_kb;   // Largest resident set size among its processes
+} job_stats_t;
+
+// A command line whose processes are still running
+typedef struct {
+    pid_t pids[MAX_ARGS];
+    int num_pids;
+    int remaining;         // Processes not reaped yet
+    struct timespec start;
+    job_stats_t stats;
+} job_t;
+
+// Buffered reader handing out the lines of a script or of a -c argument
+typedef struct {
+    int fd;       // Descriptor read from, -1 once all input is in buf
+    char* buf;
+    size_t pos;   // Start of the unread bytes
+    size_t len;   // End of the unread bytes
+    size_t cap;   // Size of buf
+} batch_input_t;
+
+job_stats_t* job_stats = NULL;  // Finished command lines, in completion order
+int job_stats_count = 0;
+int job_stats_cap = 0;
+pid_t batch_shell_pid = 0;      // Only this process prints the summary table
+
+// Function to get the milliseconds elapsed between two monotonic timestamps
+double elapsed_ms(const struct timespec* start, const struct timespec* end) {
+    return (end->tv_sec - start->tv_sec) * 1000.0 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Function to convert a struct timeval to milliseconds
+double timeval_ms(const struct timeval* tv) {
+    return tv->tv_sec * 1000.0 + tv->tv_usec / 1000.0;
+}
+
+// Function to drop batch input up to and including the next newline
+// Used when a line does not fit in the buffer, so its rest is not read as more lines.
+void skip_batch_line(batch_input_t* in) {
+    in->pos = 0;
+    in->len = 0;
+    while (in->fd >= 0) {
+        ssize_t n = read(in->fd, in->buf, in->cap);
+        if (n > 0) {
+            char* newline = memchr(in->buf, '\n', n);
+            if (newline != NULL) {
+                in->pos = newline + 1 - in->buf; // Keep what follows the line
+                in->len = n;
+                return;
+            }
+        } else if (n == 0 || errno != EINTR) {
+            // End of input inside the long line
+            if (in->fd != STDIN_FILENO) close(in->fd);
+            in->fd = -1;
+        }
+    }
+}
+
+// Function to get the next line of batch input without its newline
+// Input is read in BATCH_CHUNK_SIZE blocks; lines longer than size or than a block are truncated.
+// Returns 0 once the input is exhausted.
+int next_batch_line(batch_input_t* in, char* out, size_t size) {
+    while (1) {
+        size_t avail = in->len - in->pos;
+        char* line = in->buf + in->pos;
+        char* newline = memchr(line, '\n', avail);
+
+        if (newline == NULL && in->fd >= 0 && avail < in->cap) {
+            // Move the partial line to the front and read the next block behind it
+            memmove(in->buf, line, avail);
+            in->pos = 0;
+            in->len = avail;
+            ssize_t n = read(in->fd, in->buf + in->len, in->cap - in->len);
+            if (n > 0) {
+                in->len += n;
+            } else if (n == 0 || errno != EINTR) {
+                // End of input, whatever is left is the last line
+                if (in->fd != STDIN_FILENO) close(in->fd);
+                in->fd = -1;
+            }
+            continue;
+        }
+        if (avail == 0) {
+            return 0;
+        }
+
+        size_t line_len = newline ? (size_t)(newline - line) : avail;
+        size_t copy = (line_len < size - 1) ? line_len : size - 1;
+        memcpy(out, line, copy);
+        out[copy] = '\0';
+        if (newline == NULL && in->fd >= 0) {
+            skip_batch_line(in); // The line fills the whole buffer and goes on
+        } else {
+            in->pos += newline ? line_len + 1 : line_len;
+        }
+        return 1;
+    }
+}
+
+// Function to record the usage of a finished command line
+void record_job(const job_stats_t* stats) {
+    if (job_stats_count == job_stats_cap) {
+        job_stats_cap = job_stats_cap ? job_stats_cap * 2 : 64;
+        job_stats = realloc(job_stats, job_stats_cap * sizeof(job_stats_t));
+    }
+    job_stats[job_stats_count++] = *stats;
+}
+
+// Function to print the usage of every command line to stderr, with a total row
+void print_job_table() {
+    if (getpid() != batch_shell_pid) {
+        return;  // Forked builtin children exit through here as well
+    }
+    job_stats_t total = {"total", 0, 0, 0, 0};
+    fprintf(stderr, "%-5s %10s %10s %10s %11s  %s\n", "#", "wall(ms)", "user(ms)", "sys(ms)", "maxrss(KB)", "command");
+    for (int i = 0; i < job_stats_count; i++) {
+        job_stats_t* row = &job_stats[i];
+        fprintf(stderr, "%-5d %10.3f %10.3f %10.3f %11ld  %s\n", i + 1, row->wall_ms, row->user_ms, row->sys_ms, row->max_rss_kb, row->command);
+        total.wall_ms += row->wall_ms;
+        total.user_ms += row->user_ms;
+        total.sys_ms += row->sys_ms;
+        if (row->max_rss_kb > total.max_rss_kb) total.max_rss_kb = row->max_rss_kb;
+    }
+    fprintf(stderr, "%-5s %10.3f %10.3f %10.3f %11ld  %d commands\n", "total", total.wall_ms, total.user_ms, total.sys_ms, total.max_rss_kb, job_stats_count);
+}
+
+// Function to wait for any child process and charge its usage to the job owning it
+// A job whose last process is reaped is recorded and removed from jobs.
+void reap_job_process(job_t* jobs, int* num_jobs) {
+    int status;
+    struct rusage usage;
+    pid_t pid = wait4(-1, &status, 0, &usage);
+    if (pid < 0) {
+        *num_jobs = 0;  // No children left, nothing can still be running
+        return;
+    }
+
+    for (int j = 0; j < *num_jobs; j++) {
+        job_t* job = &jobs[j];
+        for (int i = 0; i < job->num_pids; i++) {
+            if (job->pids[i] != pid) continue;
+
+            job->stats.user_ms += timeval_ms(&usage.ru_utime);
+            job->stats.sys_ms += timeval_ms(&usage.ru_stime);
+            if (usage.ru_maxrss > job->stats.max_rss_kb) job->stats.max_rss_kb = usage.ru_maxrss;
+            if (--job->remaining == 0) {
+                struct timespec end;
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                job->stats.wall_ms = elapsed_ms(&job->start, &end);
+                record_job(&job->stats);
+                jobs[j] = jobs[--(*num_jobs)];  // Keep the running jobs packed
+            }
+            return;
+        }
+    }
+}
+
+// Function to run every line of batch input without banner or prompt
+// Up to max_jobs lines run at once. A line that is a builtin changes shell state, so
+// every running line is finished before it and it runs alone in the shell process.
+void run_batch(batch_input_t* in, int max_jobs) {
+    char input[MAX_INPUT_LENGTH];
+    job_t* jobs = malloc(max_jobs * sizeof(job_t));
+    int num_jobs = 0;
+
+    while (next_batch_line(in, input, sizeof(input))) {
+        if (input[0] == '\0' || input[0] == '#') {
+            continue;  // Skip empty lines and comments, including a #! line
+        }
+        add_to_history(input);
+        char* command = strdup(input);
+
+        job_t* job = &jobs[num_jobs];
+        if (strchr(input, '|')) {
+            clock_gettime(CLOCK_MONOTONIC, &job->start);
+            job->num_pids = start_pipeline(input, job->pids);
+        } else {
+            char* args[MAX_ARGS];
+            if (parse_command(input, args, " ") == 0) {
+                free(command);
+                continue;
+            }
+            if (find_builtin(args[0]) != NULL) {
+                while (num_jobs > 0) {
+                    reap_job_process(jobs, &num_jobs);
+                }
+                handle_builtin_commands(args);
+                free(command);
+                continue;
+            }
+            job = &jobs[num_jobs];
+            clock_gettime(CLOCK_MONOTONIC, &job->start);
+            job->pids[0] = spawn_command(args, STDIN_FILENO, STDOUT_FILENO);
+            job->num_pids = (job->pids[0] > 0) ? 1 : 0;
+        }
+
+        if (job->num_pids == 0) {
+            free(command);
+            continue;  // Nothing was started
+        }
+        job->remaining = job->num_pids;
+        job->stats = (job_stats_t){command, 0, 0, 0, 0};
+        num_jobs++;
+
+        // Keep at most max_jobs lines running
+        while (num_jobs >= max_jobs) {
+            reap_job_process(jobs, &num_jobs);
+        }
+    }
+
+    while (num_jobs > 0) {
+        reap_job_process(jobs, &num_jobs);
+    }
+    free(jobs);
+}
+
+// Function to print how the shell can be started
+void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-j jobs] [-t] [-c commands | script]\n", program);
+    fprintf(stderr, "  -c commands : Run the given newline separated commands and exit.\n");
+    fprintf(stderr, "  script      : Run the commands in the script file and exit.\n");
+    fprintf(stderr, "  -j jobs     : Run up to [jobs] independent lines at the same time.\n");
+    fprintf(stderr, "  -t          : Print wall time, CPU time and max RSS per line to stderr.\n");
 }
 
 // Main function
-int main() {
+int main(int argc, char** argv) {
+    const char* commands = NULL;  // Commands given with -c
+    int max_jobs = 1;             // Lines run at the same time in batch mode
+    int show_stats = 0;           // Print the resource usage table in batch mode
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:j:t")) != -1) {
+        switch (opt) {
+        case 'c':
+            commands = optarg;
+            break;
+        case 'j':
+            max_jobs = atoi(optarg);
+            if (max_jobs <= 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 't':
+            show_stats = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    init_builtins();  // Build the builtin dispatch table
+
+    if (commands != NULL || optind < argc) {
+        // Batch mode: no banner, no prompt and no persisted history
+        batch_input_t in = {-1, NULL, 0, 0, 0};
+        if (commands != NULL) {
+            in.buf = (char*)commands;
+            in.len = in.cap = strlen(commands);
+        } else {
+            in.fd = open(argv[optind], O_RDONLY | O_CLOEXEC);
+            if (in.fd < 0) {
+                perror(argv[optind]);
+                return 1;
+            }
+            in.cap = BATCH_CHUNK_SIZE;
+            in.buf = malloc(in.cap);
+        }
+        if (show_stats) {
+            batch_shell_pid = getpid();
+            atexit(print_job_table);  // Also covers an exit builtin in the script
+        }
+        run_batch(&in, max_jobs);
+        return 0;
+    }
 
     //initialising interface for commands, comment to avoid test script failure
 
     init_shell();
+    load_history();   // Restore the history of earlier sessions
 
     char input[MAX_INPUT_LENGTH];
     while (1) {
@@ -296,7 +1209,9 @@ int main() {
             execute_piped_commands(input);
         } else {
             char* args[MAX_ARGS];
-            parse_command(input, args, " ");  // Parse the command into arguments
+            if (parse_command(input, args, " ") == 0) {  // Parse the command into arguments
+                continue;  // Only delimiters, nothing to run
+            }
             if (!handle_builtin_commands(args)) { //check if it's builtin command, if so execute it otherwise proceed
                 // If not a built-in command, execute the command
                 execute_command(args);
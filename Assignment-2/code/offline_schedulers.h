@@ -5,17 +5,28 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
-#include <sys/time.h>
 #include <stdint.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include "scheduler_metrics.h"
 
 #define MAX_PROCESSES 1024
-#define OUTPUT_BUFFER_SIZE 1024
+#define OUTPUT_CHUNK_SIZE 65536 // Bytes moved per splice when forwarding process output
+#define NO_QUANTUM UINT64_MAX   // Quantum that lets a process run until it exits
+
+#ifndef SPLICE_F_MOVE
+#define SPLICE_F_MOVE 1         // Flags of splice/tee, from <fcntl.h> when _GNU_SOURCE is defined
+#define SPLICE_F_NONBLOCK 2
+#endif
 #define NUM_QUEUES 3
 
 // Structure to hold process information
+// Times are in nanoseconds, quanta and boost periods are given in milliseconds.
 typedef struct {
     char *command;              // Command string to be executed
     uint64_t arrival_time;     // Time when the process arrives in the system
@@ -29,24 +40,27 @@ typedef struct {
     uint64_t switchinto_time;  // Time when the process was switched into
     int error;                 // Error status of the process execution
     pid_t pid;                 // Process ID
-    char output[OUTPUT_BUFFER_SIZE]; // Buffer to capture process output
+    int output_fd;             // Read end of the output pipe while the process is alive, -1 otherwise
+    int sink_fd;               // Per-process output file, -1 if output goes to the shared destination
     int completed;            // Flag to indicate if the process has completed execution
     int started;              // Flag to indicate if the process has started execution
     int current_queue;        // Current queue of the process in Multi-Level Feedback Queue (MLFQ)
     uint64_t time_in_queue;   // Time the process has spent in the current queue
+    int cpu;                  // Logical CPU whose run queue holds the process (multi-core mode)
+    int migrations;           // Number of times the process was stolen by another CPU (multi-core mode)
 } Process;
 
 // Function prototypes
 void FCFS(Process p[], int n);
 void RoundRobin(Process p[], int n, int quantum);
 void MultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int quantum2, int boostTime);
-
-// Function to get the current time in milliseconds
-uint64_t get_current_time_ms() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL); // Get the current time of day
-    return (uint64_t)(tv.tv_sec) * 1000 + (uint64_t)(tv.tv_usec) / 1000; // Convert time to milliseconds
-}
+void MultiCoreFCFS(Process p[], int n, int num_cpus);
+void MultiCoreRoundRobin(Process p[], int n, int quantum, int num_cpus);
+void MultiCoreMultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int quantum2, int boostTime, int num_cpus);
+Process* load_trace(const char* path, int* n);
+void SimulateFCFS(Process p[], int n, const char* csv_path);
+void SimulateRoundRobin(Process p[], int n, int quantum, const char* csv_path);
+void SimulateMultiLevelFeedbackQueue(Process p[], int n, int quantum0, int quantum1, int quantum2, int boostTime, const char* csv_path);
 
 // Function to execute a command and manage its output and error status
 int execute_command(char* command, pid_t* pid, int* pipefd) {
@@ -57,6 +71,7 @@ int execute_command(char* command, pid_t* pid, int* pipefd) {
         perror("pipe"); // Print error if pipe creation fails
         return -1;
     }
+    fcntl(status_pipe[1], F_SETFD, FD_CLOEXEC); // A successful exec closes the status pipe
 
     // Fork a new process
     *pid = fork();
@@ -68,6 +83,12 @@ int execute_command(char* command, pid_t* pid, int* pipefd) {
         dup2(pipefd[1], STDERR_FILENO); // Redirect standard error to pipe
         close(pipefd[1]); // Close write end of pipe
 
+        // The dispatcher blocks SIGCHLD in the scheduler, do not pass that on
+        sigset_t chld_mask;
+        sigemptyset(&chld_mask);
+        sigaddset(&chld_mask, SIGCHLD);
+        sigprocmask(SIG_UNBLOCK, &chld_mask, NULL);
+
         // Count the number of arguments in the command
         int arg_count = 1;
         for (int i = 0; command[i]; i++) {
@@ -100,7 +121,7 @@ int execute_command(char* command, pid_t* pid, int* pipefd) {
 
         free(args); // Free allocated memory for arguments
         perror("execvp failed"); // Print error if execvp fails
-        exit(EXIT_FAILURE);
+        _exit(EXIT_FAILURE); // Do not flush stdio buffers inherited from the scheduler
     } else if (*pid < 0) {
         // Fork failed
         perror("fork failed"); // Print error if fork fails
@@ -110,30 +131,348 @@ int execute_command(char* command, pid_t* pid, int* pipefd) {
         close(pipefd[1]); // Close unused write end of pipe
         close(status_pipe[1]); // Close unused write end of status pipe
         fcntl(pipefd[0], F_SETFL, O_NONBLOCK); // Set read end of pipe to non-blocking mode
+        fcntl(pipefd[0], F_SETFD, FD_CLOEXEC); // Keep the read end out of later children
 
         // Check if the child process encountered an error
+        // The read returns as soon as the child has exec'd (EOF) or reported a failure
         int error_status = 0;
-        struct timeval timeout;
-        timeout.tv_sec = 1;  // Set timeout to 1 second
-        timeout.tv_usec = 0;
+        if (read(status_pipe[0], &error_status, sizeof(error_status)) != sizeof(error_status)) {
+            error_status = 0; // Status pipe closed by exec, no error
+        }
+
+        close(status_pipe[0]); // Close read end of status pipe
+        return error_status;
+    }
+}
+
+// Destination of the output of every process run by the offline schedulers
+// By default output is discarded; set_output_destination sends it to one file per process
+// in a directory, to a shared log, or to both. Output is moved with splice (and tee
+// when both are set) while the process runs, so it never passes through user space.
+const char* output_directory = NULL; // Directory for <index>.out files, NULL for none
+const char* output_log_path = NULL;  // Shared log file, NULL for none
+int output_log_fd = -1;              // Open shared log during a run
+int output_null_fd = -1;             // /dev/null, used when output is discarded
+int output_tee_pipe[2] = {-1, -1};   // Holds the copy for the shared log when both are set
+
+// Function to choose where process output goes, NULL for either argument disables it
+void set_output_destination(const char* directory, const char* log_path) {
+    output_directory = directory;
+    output_log_path = log_path;
+}
+
+// Function to open the shared output destinations at the start of a run
+void output_begin() {
+    if (output_log_path != NULL) {
+        // Not O_APPEND, splice refuses to write to append-only files
+        output_log_fd = open(output_log_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (output_log_fd == -1) {
+            perror("Error opening output log"); // Print error if file opening fails
+            exit(1);
+        }
+    }
+    if (output_log_fd != -1 && output_directory != NULL) {
+        if (pipe(output_tee_pipe) == -1) {
+            perror("pipe"); // Print error if pipe creation fails
+            exit(1);
+        }
+        fcntl(output_tee_pipe[0], F_SETFD, FD_CLOEXEC);
+        fcntl(output_tee_pipe[1], F_SETFD, FD_CLOEXEC);
+    }
+    output_null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (output_null_fd == -1) {
+        perror("Error opening /dev/null"); // Discarded output would have nowhere to go
+        exit(1);
+    }
+}
 
-        fd_set readfds;
-        FD_ZERO(&readfds); // Initialize the file descriptor set
-        FD_SET(status_pipe[0], &readfds); // Add status pipe to the set
+// Function to close the shared output destinations at the end of a run
+void output_end() {
+    if (output_log_fd != -1) close(output_log_fd);
+    if (output_tee_pipe[0] != -1) close(output_tee_pipe[0]);
+    if (output_tee_pipe[1] != -1) close(output_tee_pipe[1]);
+    if (output_null_fd != -1) close(output_null_fd);
+    output_log_fd = output_null_fd = output_tee_pipe[0] = output_tee_pipe[1] = -1;
+}
 
-        int ready = select(status_pipe[0] + 1, &readfds, NULL, NULL, &timeout); // Wait for data on status pipe
-        if (ready > 0 && FD_ISSET(status_pipe[0], &readfds)) {
-            read(status_pipe[0], &error_status, sizeof(error_status)); // Read error status from pipe
+// Function to move everything currently buffered in a process's output pipe
+// Returns 0 once the pipe has reached end of file, 1 if it is merely empty for now.
+int output_pump(Process* process) {
+    if (process->output_fd == -1) return 0;
+    while (1) {
+        ssize_t moved;
+        if (process->sink_fd != -1 && output_log_fd != -1) {
+            // Duplicate the pipe contents into the tee pipe, then move each copy to its file
+            moved = syscall(SYS_tee, process->output_fd, output_tee_pipe[1], OUTPUT_CHUNK_SIZE, SPLICE_F_NONBLOCK);
+            for (ssize_t left = moved; left > 0; ) {
+                ssize_t n = syscall(SYS_splice, output_tee_pipe[0], NULL, output_log_fd, NULL, left, SPLICE_F_MOVE);
+                if (n <= 0) break;
+                left -= n;
+            }
+            for (ssize_t left = moved; left > 0; ) {
+                ssize_t n = syscall(SYS_splice, process->output_fd, NULL, process->sink_fd, NULL, left, SPLICE_F_MOVE);
+                if (n <= 0) break;
+                left -= n;
+            }
         } else {
-            // Assume no error status if select times out
-            error_status = 0;
+            int sink = process->sink_fd != -1 ? process->sink_fd : (output_log_fd != -1 ? output_log_fd : output_null_fd);
+            moved = syscall(SYS_splice, process->output_fd, NULL, sink, NULL, OUTPUT_CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        }
+        if (moved == 0) return 0; // End of file, every writer is gone
+        if (moved < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN ? 1 : 0; // Empty for now, or broken
         }
+    }
+}
 
-        close(status_pipe[0]); // Close read end of status pipe
-        return error_status;
+// Function to attach the output pipe of a just started process, opening its file if needed
+void output_attach(Process* process, int index, int read_fd) {
+    process->output_fd = read_fd;
+    process->sink_fd = -1;
+    if (output_directory != NULL) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%d.out", output_directory, index);
+        process->sink_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (process->sink_fd == -1) {
+            perror("Error opening output file"); // Fall back to the shared destination
+        }
+    }
+}
+
+// Function to forward the last output of an exited process and release its descriptors
+void output_finish(Process* process) {
+    output_pump(process); // Stops at end of file, or if a grandchild still holds the pipe
+    if (process->output_fd != -1) close(process->output_fd);
+    if (process->sink_fd != -1) close(process->sink_fd);
+    process->output_fd = process->sink_fd = -1;
+}
+
+// Function to start a process and attach its output pipe, created only now
+// The time from fork to a successful exec is recorded as the process's start latency.
+int start_process(Process* process, int index) {
+    int pipefd[2]; // Pipe for standard output and error
+    uint64_t fork_time = get_current_time_ns();
+    int error = execute_command(process->command, &process->pid, pipefd);
+    if (error == -1) {
+        process->output_fd = process->sink_fd = -1; // Nothing was started
+        return 1;
+    }
+    if (error == 0) {
+        histogram_record(&scheduler_metrics.spawn, get_current_time_ns() - fork_time);
+    }
+    output_attach(process, index, pipefd[0]);
+    return error;
+}
+
+// Event sources used to dispatch the preemptive offline schedulers
+typedef struct {
+    int epoll_fd;       // Waits on both sources below at once
+    int timer_fd;       // Expires at the end of the running quantum
+    int signal_fd;      // Readable when a child changes state (SIGCHLD)
+    sigset_t old_mask;  // Signal mask to restore when the dispatcher is closed
+    uint64_t slice_end; // When the last slice ended, by SIGSTOP or exit
+} Dispatcher;
+
+// Function to set up the timer and child exit sources of a dispatcher
+void dispatcher_init(Dispatcher* d) {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &d->old_mask); // SIGCHLD is delivered through signal_fd only
+
+    d->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    d->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    d->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (d->signal_fd == -1 || d->timer_fd == -1 || d->epoll_fd == -1) {
+        perror("dispatcher"); // Print error if an event source cannot be created
+        exit(1);
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = d->signal_fd;
+    epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, d->signal_fd, &event);
+    event.data.fd = d->timer_fd;
+    epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, d->timer_fd, &event);
+    d->slice_end = 0;
+}
+
+// Function to release the event sources of a dispatcher
+void dispatcher_close(Dispatcher* d) {
+    close(d->epoll_fd);
+    close(d->timer_fd);
+    close(d->signal_fd);
+    sigprocmask(SIG_SETMASK, &d->old_mask, NULL); // Restore the caller's signal mask
+}
+
+// Function to let a started or continued process run for at most quantum milliseconds
+// Blocks until either the process exits or the quantum expires, whichever comes first,
+// so the next process is switched in as soon as the current one finishes. Output is
+// forwarded as it arrives. NO_QUANTUM runs the process until it exits.
+// Returns 1 if the process exited, 0 if it was stopped at the end of its quantum.
+int dispatch_slice(Dispatcher* d, Process* process, uint64_t quantum) {
+    struct itimerspec slice;
+    memset(&slice, 0, sizeof(slice));
+    if (quantum != NO_QUANTUM) {
+        slice.it_value.tv_sec = quantum / 1000;
+        slice.it_value.tv_nsec = (quantum % 1000) * 1000000;
+        if (quantum == 0) {
+            slice.it_value.tv_nsec = 1; // A zero it_value would disarm the timer
+        }
+        timerfd_settime(d->timer_fd, 0, &slice, NULL); // Arming also resets pending expirations
+    }
+
+    // Watch the output pipe only while the process can write to it
+    int output_watched = 0;
+    if (process->output_fd != -1) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = process->output_fd;
+        output_watched = epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, process->output_fd, &event) == 0;
+    }
+
+    int finished = 0;
+    while (1) {
+        struct epoll_event events[3];
+        int ready = epoll_wait(d->epoll_fd, events, 3, -1);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait"); // Print error if waiting for events fails
+            exit(1);
+        }
+
+        int expired = 0;
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.fd == d->signal_fd) {
+                struct signalfd_siginfo info;
+                while (read(d->signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                    // Drain every queued SIGCHLD, waitpid tells which child exited
+                }
+            } else if (events[i].data.fd == d->timer_fd) {
+                uint64_t expirations;
+                if (read(d->timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                    expired = 1;
+                }
+            } else if (output_watched && events[i].data.fd == process->output_fd) {
+                if (output_pump(process) == 0) {
+                    // Writers closed the pipe, stop watching it so a hangup does not spin
+                    epoll_ctl(d->epoll_fd, EPOLL_CTL_DEL, process->output_fd, NULL);
+                    output_watched = 0;
+                }
+            }
+        }
+
+        int status;
+        if (waitpid(process->pid, &status, WNOHANG) == process->pid) {
+            memset(&slice, 0, sizeof(slice));
+            timerfd_settime(d->timer_fd, 0, &slice, NULL); // Disarm the unused rest of the quantum
+            finished = 1;
+            break;
+        }
+        if (expired) {
+            kill(process->pid, SIGSTOP); // Stop the process
+            // The process may have exited right before it was stopped
+            finished = waitpid(process->pid, &status, WNOHANG) == process->pid;
+            break;
+        }
+    }
+
+    if (output_watched) {
+        epoll_ctl(d->epoll_fd, EPOLL_CTL_DEL, process->output_fd, NULL);
+    }
+    d->slice_end = get_current_time_ns();
+    return finished;
+}
+
+// Function to continue a stopped process, recording the context switch since the last slice ended
+void resume_process(Process* process, uint64_t slice_end) {
+    uint64_t now = get_current_time_ns();
+    if (slice_end != 0) {
+        histogram_record(&scheduler_metrics.context_switch, now - slice_end);
+    }
+    kill(process->pid, SIGCONT); // Continue the process if it was stopped
+}
+
+// Multi-level FIFO run queue over process indices, with a bitmap of the non-empty levels
+// The links live in a separate next[] array indexed like the process array, so pushing,
+// popping the highest priority process and boosting are all independent of the number
+// of processes queued.
+typedef struct {
+    int head[NUM_QUEUES];   // First waiting process of each level, -1 if empty
+    int tail[NUM_QUEUES];   // Last waiting process of each level, -1 if empty
+    unsigned int nonempty;  // Bit l is set when level l has waiting processes
+    int waiting;            // Number of waiting processes over all levels
+} RunQueue;
+
+// Function to empty a run queue
+void runqueue_init(RunQueue* rq) {
+    for (int level = 0; level < NUM_QUEUES; level++) {
+        rq->head[level] = rq->tail[level] = -1;
+    }
+    rq->nonempty = 0;
+    rq->waiting = 0;
+}
+
+// Function to append process i to the tail of a level
+void runqueue_push(RunQueue* rq, int* next, int level, int i) {
+    next[i] = -1;
+    if (rq->tail[level] == -1) {
+        rq->head[level] = i;
+    } else {
+        next[rq->tail[level]] = i;
+    }
+    rq->tail[level] = i;
+    rq->nonempty |= 1u << level;
+    rq->waiting++;
+}
+
+// Function to remove the first process of the highest priority non-empty level
+// Returns -1 if the queue is empty, otherwise stores the level it came from.
+int runqueue_pop(RunQueue* rq, int* next, int* level) {
+    if (rq->nonempty == 0) return -1;
+    int l = __builtin_ctz(rq->nonempty); // Lowest set bit is the highest priority level
+    int i = rq->head[l];
+    rq->head[l] = next[i];
+    if (rq->head[l] == -1) {
+        rq->tail[l] = -1;
+        rq->nonempty &= ~(1u << l);
+    }
+    rq->waiting--;
+    *level = l;
+    return i;
+}
+
+// Function to move every waiting process to level 0, keeping their order within each level
+// Lower levels are spliced onto level 0 as whole lists, so a boost costs O(levels).
+// The level recorded in a moved process is corrected when it is popped.
+void runqueue_boost(RunQueue* rq, int* next) {
+    for (int level = 1; level < NUM_QUEUES; level++) {
+        if (rq->head[level] == -1) continue;
+        if (rq->tail[0] == -1) {
+            rq->head[0] = rq->head[level];
+        } else {
+            next[rq->tail[0]] = rq->head[level];
+        }
+        rq->tail[0] = rq->tail[level];
+        rq->head[level] = rq->tail[level] = -1;
+    }
+    if (rq->head[0] != -1) {
+        rq->nonempty = 1u;
     }
 }
 
+// Function to pop the next process and bring its recorded MLFQ level up to date
+int runqueue_pop_process(RunQueue* rq, int* next, Process processes[]) {
+    int level;
+    int i = runqueue_pop(rq, next, &level);
+    if (i != -1 && processes[i].current_queue != level) {
+        processes[i].current_queue = level; // Boosted while it was waiting
+        processes[i].time_in_queue = 0; // Reset time in queue
+    }
+    return i;
+}
+
 // Function to duplicate commands for each process
 void duplicate_commands(Process processes[], int n) {
     for (int i = 0; i < n; i++) {
@@ -149,14 +488,51 @@ void calculate_time_metrics(Process* process) {
     process->turnaround_time = process->completion_time - process->arrival_time; // Calculate turnaround time
     process->waiting_time = process->turnaround_time - process->burst_time; // Calculate waiting time
     process->response_time = process->start_time - process->arrival_time; // Calculate response time
+    metrics_record_process(process->turnaround_time, process->waiting_time, process->response_time);
+}
+
+// Function to append the common columns of a process to a result row, times in milliseconds
+void write_process_columns(ResultWriter* w, const Process* p) {
+    result_write_str(w, p->command);
+    result_write_str(w, p->error ? ",No,Yes," : ",Yes,No,");
+    result_write_ms(w, p->burst_time);
+    result_write_char(w, ',');
+    result_write_ms(w, p->turnaround_time);
+    result_write_char(w, ',');
+    result_write_ms(w, p->waiting_time);
+    result_write_char(w, ',');
+    result_write_ms(w, p->response_time);
+}
+
+// Function to write the metrics of every process to a CSV file, and their histograms next to it
+void write_results(const char* path, Process processes[], int n) {
+    ResultWriter* w = malloc(sizeof(ResultWriter));
+    if (w == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    result_writer_open(w, path);
+
+    // Write CSV header
+    result_write_str(w, "Command,Finished,Error,Burst Time,Turnaround Time,Waiting Time,Response Time\n");
+
+    // Write process information to CSV
+    for (int i = 0; i < n; i++) {
+        write_process_columns(w, &processes[i]);
+        result_write_char(w, '\n');
+    }
+
+    result_writer_close(w); // Close the file
+    free(w);
+    metrics_write(path);
 }
 
 // Function to execute processes using First-Come, First-Served (FCFS) scheduling
 void FCFS(Process processes[], int n) {
     duplicate_commands(processes, n); // Duplicate commands for each process
+    metrics_reset();
 
     uint64_t current_time = 0; // Track the current time
-    int pipefd[MAX_PROCESSES][2]; // Pipes for communication between processes
 
     // Initialize all processes
     for (int i = 0; i < n; i++) {
@@ -165,30 +541,30 @@ void FCFS(Process processes[], int n) {
         processes[i].completion_time = 0; // Initialize completion time
         processes[i].burst_time = 0;     // Initialize burst time
         processes[i].error = 0;           // Initialize error status
-        processes[i].output[0] = '\0';    // Initialize output buffer
+        processes[i].output_fd = -1;      // Output pipe is created when the process starts
+        processes[i].sink_fd = -1;
         processes[i].completed = 0;       // Mark process as not completed
         processes[i].started = 0;         // Mark process as not started
-
-        // Create a pipe for each process
-        if (pipe(pipefd[i]) == -1) {
-            perror("pipe"); // Print error if pipe creation fails
-            exit(1);
-        }
     }
 
     // Execute processes sequentially
+    Dispatcher dispatcher;
+    dispatcher_init(&dispatcher);
+    output_begin();
+
     for (int i = 0; i < n; i++) {
         if (!processes[i].completed) {
             // Set the start time for the process
             processes[i].start_time = current_time;
 
             // Execute the command and measure burst time
-            uint64_t start_exec = get_current_time_ms(); // Record start time of execution
-            processes[i].error = execute_command(processes[i].command, &processes[i].pid, pipefd[i]);
+            uint64_t start_exec = get_current_time_ns(); // Record start time of execution
+            processes[i].error = start_process(&processes[i], i);
             
-            int status;
-            waitpid(processes[i].pid, &status, 0);  // Wait for the command to finish
-            uint64_t end_exec = get_current_time_ms(); // Record end time of execution
+            if (processes[i].output_fd != -1) {
+                dispatch_slice(&dispatcher, &processes[i], NO_QUANTUM); // Wait for the command to finish, forwarding its output
+            }
+            uint64_t end_exec = get_current_time_ns(); // Record end time of execution
             
             processes[i].burst_time = end_exec - start_exec; // Calculate burst time
             current_time += processes[i].burst_time; // Update current time
@@ -198,52 +574,25 @@ void FCFS(Process processes[], int n) {
             processes[i].completed = 1; // Mark process as completed
             calculate_time_metrics(&processes[i]); // Calculate time metrics
 
-            // Read the process output
-            char buffer[OUTPUT_BUFFER_SIZE];
-            ssize_t bytes_read;
-            while ((bytes_read = read(pipefd[i][0], buffer, sizeof(buffer) - 1)) > 0) {
-                buffer[bytes_read] = '\0'; // Null-terminate the buffer
-                strcat(processes[i].output, buffer); // Append buffer content to process output
-            }
-            close(pipefd[i][0]); // Close the read end of the pipe
+            output_finish(&processes[i]); // Forward the rest of the output
 
             // Print process information
-            printf("%s|%lu|%lu\n", processes[i].command, processes[i].start_time, processes[i].completion_time);
+            printf("%s|%lu|%lu\n", processes[i].command, processes[i].start_time / NS_PER_MS, processes[i].completion_time / NS_PER_MS);
         }
     }
+    output_end();
+    dispatcher_close(&dispatcher);
 
-    // Write results to CSV file
-    FILE *fp = fopen("result_offline_FCFS.csv", "w");
-    if (fp == NULL) {
-        perror("Error opening file"); // Print error if file opening fails
-        exit(1);
-    }
-
-    // Write CSV header
-    fprintf(fp, "Command,Finished,Error,Burst Time,Turnaround Time,Waiting Time,Response Time\n");
-
-    // Write process information to CSV
-    for (int i = 0; i < n; i++) {
-        fprintf(fp, "%s,%s,%s,%lu,%lu,%lu,%lu\n", 
-                processes[i].command, 
-                processes[i].error ? "No" : "Yes",
-                processes[i].error ? "Yes" : "No",
-                processes[i].burst_time, 
-                processes[i].turnaround_time, 
-                processes[i].waiting_time, 
-                processes[i].response_time);
-    }
-
-    fclose(fp); // Close the file
+    write_results("result_offline_FCFS.csv", processes, n); // Write results to CSV file
 }
 
 // Function to execute processes using Round-Robin (RR) scheduling
 void RoundRobin(Process processes[], int n, int quantum) {
     duplicate_commands(processes, n); // Duplicate commands for each process
+    metrics_reset();
 
     uint64_t current_time = 0; // Track the current time
     int completed = 0;         // Count of completed processes
-    int pipefd[MAX_PROCESSES][2]; // Pipes for communication between processes
 
     // Initialize all processes
     for (int i = 0; i < n; i++) {
@@ -252,102 +601,79 @@ void RoundRobin(Process processes[], int n, int quantum) {
         processes[i].completion_time = 0; // Initialize completion time
         processes[i].burst_time = 0;     // Initialize burst time
         processes[i].error = 0;           // Initialize error status
-        processes[i].output[0] = '\0';    // Initialize output buffer
+        processes[i].output_fd = -1;      // Output pipe is created when the process starts
+        processes[i].sink_fd = -1;
         processes[i].completed = 0;       // Mark process as not completed
         processes[i].started = 0;         // Mark process as not started
-
-        // Create a pipe for each process
-        if (pipe(pipefd[i]) == -1) {
-            perror("pipe"); // Print error if pipe creation fails
-            exit(1);
-        }
     }
 
     // Execute processes in a round-robin manner
+    Dispatcher dispatcher;
+    dispatcher_init(&dispatcher);
+    output_begin();
+    uint64_t origin = get_current_time_ns(); // All times are measured from here
+
     while (completed < n) {
         for (int i = 0; i < n; i++) {
             if (!processes[i].completed) {
-                processes[i].switchinto_time = current_time; // Record start time of quantum
+                processes[i].switchinto_time = get_current_time_ns() - origin; // Record start time of quantum
 
                 if (!processes[i].started) {
-                    processes[i].start_time = current_time; // Set start time for the process
-                    processes[i].error = execute_command(processes[i].command, &processes[i].pid, pipefd[i]);
+                    processes[i].start_time = processes[i].switchinto_time; // Set start time for the process
+                    processes[i].error = start_process(&processes[i], i);
                     processes[i].started = 1; // Mark process as started
                 } else {
-                    kill(processes[i].pid, SIGCONT); // Continue the process if it was stopped
+                    resume_process(&processes[i], dispatcher.slice_end); // Continue the process if it was stopped
                 }
 
-                usleep(quantum * 1000); // Sleep for the quantum duration (convert milliseconds to microseconds)
-                current_time += quantum; // Update current time
+                // Run until exit or end of quantum, unless the process could not be started at all
+                int finished = processes[i].output_fd == -1 || dispatch_slice(&dispatcher, &processes[i], quantum);
+                current_time = get_current_time_ns() - origin; // Update current time
+                processes[i].burst_time += current_time - processes[i].switchinto_time; // Update burst time with the measured run
 
-                int status;
-                pid_t result = waitpid(processes[i].pid, &status, WNOHANG); // Non-blocking wait
-
-                if (result == 0) {
-                    // Process is still running, stop it
-                    kill(processes[i].pid, SIGSTOP); // Stop the process
-                    processes[i].burst_time += quantum; // Update burst time
-                } else {
+                if (finished) {
                     // Process finished during this quantum
                     processes[i].completed = 1; // Mark process as completed
                     completed++; // Increment completed processes count
                     processes[i].completion_time = current_time; // Set completion time
-                    processes[i].burst_time += (current_time-processes[i].switchinto_time); // Update burst time
-                    
-                    // Read remaining output
-                    char buffer[OUTPUT_BUFFER_SIZE];
-                    ssize_t bytes_read;
-                    while ((bytes_read = read(pipefd[i][0], buffer, sizeof(buffer) - 1)) > 0) {
-                        buffer[bytes_read] = '\0'; // Null-terminate the buffer
-                        strcat(processes[i].output, buffer); // Append buffer content to process output
-                    }
-                    close(pipefd[i][0]); // Close the read end of the pipe
+                    output_finish(&processes[i]); // Forward the rest of the output
                     
                     calculate_time_metrics(&processes[i]); // Calculate time metrics
                 }
                 processes[i].switch_time=current_time;
                 // Print process information after every context switch
-                printf("%s|%lu|%lu\n", processes[i].command, processes[i].switchinto_time, processes[i].switch_time);
+                printf("%s|%lu|%lu\n", processes[i].command, processes[i].switchinto_time / NS_PER_MS, processes[i].switch_time / NS_PER_MS);
             }
         }
     }
+    output_end();
+    dispatcher_close(&dispatcher);
 
-    // Write results to CSV file
-    FILE *fp = fopen("result_offline_RR.csv", "w");
-    if (fp == NULL) {
-        perror("Error opening file"); // Print error if file opening fails
-        exit(1);
-    }
-
-    // Write CSV header
-    fprintf(fp, "Command,Finished,Error,Burst Time,Turnaround Time,Waiting Time,Response Time\n");
-
-    // Write process information to CSV
-    for (int i = 0; i < n; i++) {
-        fprintf(fp, "%s,%s,%s,%lu,%lu,%lu,%lu\n", 
-                processes[i].command, 
-                processes[i].error ? "No" : "Yes",
-                processes[i].error ? "Yes" : "No",
-                processes[i].burst_time, 
-                processes[i].turnaround_time, 
-                processes[i].waiting_time, 
-                processes[i].response_time);
-    }
-
-    fclose(fp); // Close the file
+    write_results("result_offline_RR.csv", processes, n); // Write results to CSV file
 }
 
 // Function to execute processes using Multi-Level Feedback Queue (MLFQ) scheduling
+// The next process always comes from the head of the highest priority non-empty level;
+// a process that uses up its quantum is demoted to the tail of the next level.
 void MultiLevelFeedbackQueue(Process processes[], int n, int quantum0, int quantum1, int quantum2, int S) {
     duplicate_commands(processes, n); // Duplicate commands for each process
+    metrics_reset();
 
     int quantum[3] = {quantum0, quantum1, quantum2}; // Quantum times for each queue
 
     uint64_t current_time = 0; // Track the current time
     int completed = 0;         // Count of completed processes
-    int pipefd[MAX_PROCESSES][2]; // Pipes for communication between processes
     uint64_t last_boost_time = 0; // Track last boost time
 
+    // Queue links are sized by n, so there is no limit on the number of processes
+    int* next = malloc(n * sizeof(int)); // Run queue links
+    if (next == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    RunQueue queue;
+    runqueue_init(&queue);
+
     // Initialize all processes
     for (int i = 0; i < n; i++) {
         processes[i].arrival_time = 0;  // Set arrival time to 0 for all processes
@@ -357,122 +683,718 @@ void MultiLevelFeedbackQueue(Process processes[], int n, int quantum0, int quant
         processes[i].switchinto_time = -1; // Initialize time when switched into
         processes[i].burst_time = 0;     // Initialize burst time
         processes[i].error = 0;           // Initialize error status
-        processes[i].output[0] = '\0';    // Initialize output buffer
+        processes[i].output_fd = -1;      // Output pipe is created when the process starts
+        processes[i].sink_fd = -1;
         processes[i].completed = 0;       // Mark process as not completed
         processes[i].started = 0;         // Mark process as not started
         processes[i].current_queue = 0;   // Initialize queue to 0
         processes[i].time_in_queue = 0;   // Initialize time in queue
 
-        // Create a pipe for each process
-        if (pipe(pipefd[i]) == -1) {
-            perror("pipe"); // Print error if pipe creation fails
-            exit(1);
-        }
+        runqueue_push(&queue, next, 0, i); // All processes start in the highest priority queue
     }
 
     // Execute processes using MLFQ scheduling
+    Dispatcher dispatcher;
+    dispatcher_init(&dispatcher);
+    output_begin();
+    uint64_t origin = get_current_time_ns(); // All times are measured from here
+
     while (completed < n) {
-        // Boost processes to the highest priority queue after time S
-        if (current_time - last_boost_time >= S) {
-            
-            for (int i = 0; i < n; i++) {
-                if (!processes[i].completed) {
-                    processes[i].current_queue = 0; // Move process to highest priority queue
-                    processes[i].time_in_queue = 0; // Reset time in queue
-                }
+        int i = runqueue_pop_process(&queue, next, processes);
+        processes[i].switchinto_time = get_current_time_ns() - origin; // Record time when process is switched into
+        int q = processes[i].current_queue; // Get the current queue of the process
+
+        if (!processes[i].started) {
+            processes[i].start_time = processes[i].switchinto_time; // Set start time for the process
+            processes[i].error = start_process(&processes[i], i);
+            processes[i].started = 1; // Mark process as started
+        } else {
+            resume_process(&processes[i], dispatcher.slice_end); // Continue the process if it was stopped
+        }
+
+        // Run until exit or end of quantum, unless the process could not be started at all
+        int finished = processes[i].output_fd == -1 || dispatch_slice(&dispatcher, &processes[i], quantum[q]);
+        current_time = get_current_time_ns() - origin; // Update current time
+
+        uint64_t executed_time = current_time - processes[i].switchinto_time; // Measured time executed
+
+        processes[i].time_in_queue += executed_time; // Update time in queue
+        processes[i].burst_time += executed_time; // Update burst time
+
+        if (!finished) {
+            // Process is still running, move to next queue if not in the lowest queue
+            if (processes[i].current_queue < NUM_QUEUES - 1) {
+                processes[i].current_queue++; // Move to next lower priority queue
+                processes[i].time_in_queue = 0; // Reset time in queue
             }
+            runqueue_push(&queue, next, processes[i].current_queue, i);
+        } else {
+            // Process finished during this quantum
+            processes[i].completed = 1; // Mark process as completed
+            completed++; // Increment completed processes count
+            processes[i].completion_time = current_time; // Set completion time
+
+            output_finish(&processes[i]); // Forward the rest of the output
+
+            calculate_time_metrics(&processes[i]); // Calculate time metrics
+        }
+        processes[i].switch_time=current_time;
+        // Print process information after every context switch
+        printf("%s|%lu|%lu\n", processes[i].command, processes[i].switchinto_time / NS_PER_MS, processes[i].switch_time / NS_PER_MS);
+
+        // Boost processes to the highest priority queue after time S
+        if (current_time - last_boost_time >= (uint64_t)S * NS_PER_MS) {
+            runqueue_boost(&queue, next);
             last_boost_time = current_time; // Update last boost time
         }
+    }
+    output_end();
+    dispatcher_close(&dispatcher);
+    free(next);
 
-        for (int i = 0; i < n; i++) {
-            if (!processes[i].completed) {
-                processes[i].switchinto_time = current_time; // Record time when process is switched into
-                int q = processes[i].current_queue; // Get the current queue of the process
+    write_results("result_offline_MLFQ.csv", processes, n); // Write results to CSV file
+}
 
-                if (!processes[i].started) {
-                    processes[i].start_time = current_time; // Set start time for the process
-                    processes[i].error = execute_command(processes[i].command, &processes[i].pid, pipefd[i]);
-                    processes[i].started = 1; // Mark process as started
-                } else {
-                    kill(processes[i].pid, SIGCONT); // Continue the process if it was stopped
-                }
+// Scheduling policy applied to every per-CPU run queue in multi-core mode
+typedef enum {
+    POLICY_FCFS,  // One FIFO level, processes run to completion
+    POLICY_RR,    // One FIFO level, processes are preempted after a quantum
+    POLICY_MLFQ   // NUM_QUEUES levels with demotion and periodic boost
+} SchedPolicy;
 
-                usleep(1000 * quantum[q]); // Sleep for the quantum duration (convert milliseconds to microseconds)
-                kill(processes[i].pid, SIGSTOP); // Stop the process
+// Run queue and accounting of one logical CPU in multi-core mode
+typedef struct {
+    RunQueue queue;        // Processes waiting for this CPU
+    int running;           // Process running on this CPU, -1 if idle
+    int timer_fd;          // Quantum timer of this CPU
+    int host_cpu;          // Host CPU the processes of this queue are pinned to
+    uint64_t busy_time;    // Time spent running processes
+    uint64_t slice_end;    // When the last process was switched out, 0 before the first
+    int migrations;        // Number of processes stolen from other CPUs
+} CpuQueue;
+
+// State shared by all logical CPUs of a multi-core run
+typedef struct {
+    Process* processes;
+    int n;
+    SchedPolicy policy;
+    const int* quantum;    // Quantum of each level, NULL for FCFS
+    uint64_t boost_time;   // MLFQ boost period in nanoseconds
+    uint64_t last_boost;   // Time of the last MLFQ boost
+    CpuQueue* cpus;
+    int num_cpus;
+    int* next;             // Next process in the same run queue level, -1 at the tail
+    int epoll_fd;          // Waits on signal_fd and every CPU timer
+    int signal_fd;         // Readable when a child changes state (SIGCHLD)
+    sigset_t old_mask;     // Signal mask to restore at the end of the run
+    uint64_t origin;       // All times are measured from here
+    int completed;         // Number of processes completed
+} MultiCoreScheduler;
+
+// Function to list the host CPUs the scheduler may use, looping over them if there are fewer than asked
+void multicore_assign_host_cpus(MultiCoreScheduler* s) {
+    unsigned long mask[16]; // Room for 1024 host CPUs
+    memset(mask, 0, sizeof(mask));
+    int bits = 8 * sizeof(unsigned long);
+    int allowed[16 * 8 * sizeof(unsigned long)];
+    int num_allowed = 0;
+
+    if (syscall(SYS_sched_getaffinity, 0, sizeof(mask), mask) > 0) {
+        for (int cpu = 0; cpu < 16 * bits; cpu++) {
+            if (mask[cpu / bits] & (1UL << (cpu % bits))) {
+                allowed[num_allowed++] = cpu;
+            }
+        }
+    }
+    for (int c = 0; c < s->num_cpus; c++) {
+        s->cpus[c].host_cpu = num_allowed ? allowed[c % num_allowed] : -1;
+    }
+}
 
-                uint64_t executed_time = quantum[q]; // Time quantum executed
-                
-                processes[i].time_in_queue += executed_time; // Update time in queue
-                processes[i].burst_time += executed_time; // Update burst time
-                current_time += executed_time; // Update current time
+// Function to pin a process to the host CPU of a logical CPU
+// Uses the raw system call so the header does not depend on _GNU_SOURCE for cpu_set_t.
+void multicore_pin(MultiCoreScheduler* s, int c, pid_t pid) {
+    int host = s->cpus[c].host_cpu;
+    if (host < 0) return;
+    unsigned long mask[16];
+    memset(mask, 0, sizeof(mask));
+    mask[host / (8 * sizeof(unsigned long))] |= 1UL << (host % (8 * sizeof(unsigned long)));
+    syscall(SYS_sched_setaffinity, pid, sizeof(mask), mask);
+}
 
-                int status;
-                pid_t result = waitpid(processes[i].pid, &status, WNOHANG); // Non-blocking wait
+// Function to append a process to the tail of its level on a CPU
+void multicore_enqueue(MultiCoreScheduler* s, int c, int i) {
+    runqueue_push(&s->cpus[c].queue, s->next, s->processes[i].current_queue, i);
+    s->processes[i].cpu = c;
+}
 
-                if (result == 0) {
-                    // Process is still running, move to next queue if not in the lowest queue
-                    if (processes[i].current_queue < NUM_QUEUES - 1) {
-                        processes[i].current_queue++; // Move to next lower priority queue
-                        processes[i].time_in_queue = 0; // Reset time in queue
-                    }
-                } else {
-                    // Process finished during this quantum
-                    processes[i].completed = 1; // Mark process as completed
-                    completed++; // Increment completed processes count
-                    processes[i].completion_time = current_time; // Set completion time
+// Function to let an idle CPU take the next waiting process of the CPU with the most waiting
+int multicore_steal(MultiCoreScheduler* s, int thief) {
+    int victim = -1;
+    for (int c = 0; c < s->num_cpus; c++) {
+        int waiting = s->cpus[c].queue.waiting;
+        if (c != thief && waiting > 0 && (victim == -1 || waiting > s->cpus[victim].queue.waiting)) {
+            victim = c;
+        }
+    }
+    if (victim == -1) return -1;
+
+    int i = runqueue_pop_process(&s->cpus[victim].queue, s->next, s->processes);
+    s->processes[i].migrations++;
+    s->processes[i].cpu = thief;
+    s->cpus[thief].migrations++;
+    if (s->processes[i].started) {
+        multicore_pin(s, thief, s->processes[i].pid); // Move the stopped process along with its queue
+    }
+    return i;
+}
 
-                    // Read remaining output
-                    char buffer[OUTPUT_BUFFER_SIZE];
-                    ssize_t bytes_read;
-                    while ((bytes_read = read(pipefd[i][0], buffer, sizeof(buffer) - 1)) > 0) {
-                        buffer[bytes_read] = '\0'; // Null-terminate the buffer
-                        strcat(processes[i].output, buffer); // Append buffer content to process output
-                    }
-                    close(pipefd[i][0]); // Close the read end of the pipe
-                    
-                    calculate_time_metrics(&processes[i]); // Calculate time metrics
+void multicore_switch_out(MultiCoreScheduler* s, int c, int finished);
+
+// Function to switch the next process in on an idle CPU, stealing work if its own queue is empty
+// A process that cannot be started is recorded as finished and the next one is tried, so
+// the CPU only stays idle once there is no work left anywhere: an idle CPU has no timer
+// or child left to wake the scheduler for the work still queued.
+void multicore_switch_in(MultiCoreScheduler* s, int c) {
+    CpuQueue* cpu = &s->cpus[c];
+    Process* p;
+    while (1) {
+        int i = runqueue_pop_process(&cpu->queue, s->next, s->processes);
+        if (i == -1) {
+            i = multicore_steal(s, c);
+        }
+        cpu->running = i;
+        if (i == -1) return; // Nothing left to run anywhere, stay idle
+
+        p = &s->processes[i];
+        p->switchinto_time = get_current_time_ns() - s->origin; // Record time when process is switched into
+        if (p->started) {
+            resume_process(p, cpu->slice_end); // Continue the process if it was stopped
+            break;
+        }
+        p->start_time = p->switchinto_time; // Set start time for the process
+        p->error = start_process(p, i);
+        p->started = 1; // Mark process as started
+        if (p->output_fd != -1) {
+            multicore_pin(s, c, p->pid);
+            break;
+        }
+        multicore_switch_out(s, c, 1); // Could not be started at all, record it as finished
+    }
+
+    // Forward output while the process runs, the tag tells which CPU it belongs to
+    if (p->output_fd != -1) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = s->num_cpus + 1 + c;
+        epoll_ctl(s->epoll_fd, EPOLL_CTL_ADD, p->output_fd, &event);
+    }
+
+    if (s->policy != POLICY_FCFS) {
+        uint64_t quantum = s->quantum[p->current_queue];
+        struct itimerspec slice;
+        memset(&slice, 0, sizeof(slice));
+        slice.it_value.tv_sec = quantum / 1000;
+        slice.it_value.tv_nsec = (quantum % 1000) * 1000000;
+        if (quantum == 0) {
+            slice.it_value.tv_nsec = 1; // A zero it_value would disarm the timer
+        }
+        timerfd_settime(cpu->timer_fd, 0, &slice, NULL);
+    }
+}
+
+// Function to switch the running process out of a CPU, either finished or preempted
+void multicore_switch_out(MultiCoreScheduler* s, int c, int finished) {
+    CpuQueue* cpu = &s->cpus[c];
+    int i = cpu->running;
+    Process* p = &s->processes[i];
+    uint64_t current_time = get_current_time_ns() - s->origin;
+    uint64_t executed_time = current_time - p->switchinto_time; // Measured time executed
+
+    p->burst_time += executed_time; // Update burst time
+    p->time_in_queue += executed_time; // Update time in queue
+    cpu->busy_time += executed_time;
+    cpu->slice_end = current_time + s->origin;
+    cpu->running = -1;
+    if (p->output_fd != -1) {
+        epoll_ctl(s->epoll_fd, EPOLL_CTL_DEL, p->output_fd, NULL); // Stopped or gone, nothing more to watch
+    }
+
+    if (finished) {
+        struct itimerspec off;
+        memset(&off, 0, sizeof(off));
+        timerfd_settime(cpu->timer_fd, 0, &off, NULL); // Disarm the unused rest of the quantum
+
+        p->completed = 1; // Mark process as completed
+        s->completed++;
+        p->completion_time = current_time; // Set completion time
+
+        output_finish(p); // Forward the rest of the output
+
+        calculate_time_metrics(p); // Calculate time metrics
+    } else {
+        if (s->policy == POLICY_MLFQ && p->current_queue < NUM_QUEUES - 1) {
+            p->current_queue++; // Move to next lower priority queue
+            p->time_in_queue = 0; // Reset time in queue
+        }
+        multicore_enqueue(s, c, i); // Back to the tail of its level on the same CPU
+    }
+
+    p->switch_time = current_time;
+    // Print process information after every context switch
+    printf("%s|%lu|%lu\n", p->command, p->switchinto_time / NS_PER_MS, p->switch_time / NS_PER_MS);
+}
+
+// Function to boost every waiting and running process to the highest priority level
+void multicore_boost(MultiCoreScheduler* s) {
+    for (int c = 0; c < s->num_cpus; c++) {
+        CpuQueue* cpu = &s->cpus[c];
+        runqueue_boost(&cpu->queue, s->next);
+        if (cpu->running != -1) {
+            s->processes[cpu->running].current_queue = 0; // Move process to highest priority queue
+            s->processes[cpu->running].time_in_queue = 0; // Reset time in queue
+        }
+    }
+}
+
+// Function to write the per-process and per-CPU results of a multi-core run
+// Named result_offline_multicore_*, apart from the single-core results of the same policy.
+void multicore_write_results(MultiCoreScheduler* s, const char* name) {
+    char path[256];
+    snprintf(path, sizeof(path), "result_offline_multicore_%s.csv", name);
+    ResultWriter* w = malloc(sizeof(ResultWriter));
+    if (w == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    result_writer_open(w, path);
+
+    // Write CSV header
+    result_write_str(w, "Command,Finished,Error,Burst Time,Turnaround Time,Waiting Time,Response Time,CPU,Migrations\n");
+
+    // Write process information to CSV
+    uint64_t makespan = 0;
+    for (int i = 0; i < s->n; i++) {
+        Process* p = &s->processes[i];
+        write_process_columns(w, p);
+        result_write_char(w, ',');
+        result_write_int(w, p->cpu);
+        result_write_char(w, ',');
+        result_write_int(w, p->migrations);
+        result_write_char(w, '\n');
+        if (p->completion_time > makespan) makespan = p->completion_time;
+    }
+    result_writer_close(w); // Close the file
+    metrics_write(path);
+
+    // Write per-CPU utilisation and migrations next to it
+    snprintf(path, sizeof(path), "result_offline_multicore_%s_cpus.csv", name);
+    result_writer_open(w, path);
+    result_write_str(w, "CPU,Host CPU,Busy Time,Utilisation,Migrations\n");
+    for (int c = 0; c < s->num_cpus; c++) {
+        CpuQueue* cpu = &s->cpus[c];
+        result_write_int(w, c);
+        result_write_char(w, ',');
+        result_write_int(w, cpu->host_cpu);
+        result_write_char(w, ',');
+        result_write_ms(w, cpu->busy_time);
+        result_write_char(w, ',');
+        result_write_milli(w, makespan ? cpu->busy_time * 1000 / makespan : 0);
+        result_write_char(w, ',');
+        result_write_int(w, cpu->migrations);
+        result_write_char(w, '\n');
+    }
+    result_writer_close(w); // Close the file
+    free(w);
+}
+
+// Function to execute processes on several logical CPUs, each with its own run queue
+// Processes are dealt round-robin over the CPUs and pinned to them with sched_setaffinity.
+// A CPU whose queue runs empty steals the next process of the busiest queue.
+void multicore_run(Process processes[], int n, SchedPolicy policy, const int* quantum, int boost_time,
+                   int num_cpus, const char* name) {
+    duplicate_commands(processes, n); // Duplicate commands for each process
+    metrics_reset();
+
+    if (num_cpus <= 0) {
+        num_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN); // Default to every online CPU
+    }
+
+    MultiCoreScheduler s;
+    memset(&s, 0, sizeof(s));
+    s.processes = processes;
+    s.n = n;
+    s.policy = policy;
+    s.quantum = quantum;
+    s.boost_time = (uint64_t)boost_time * NS_PER_MS;
+    s.num_cpus = num_cpus;
+    s.cpus = calloc(num_cpus, sizeof(CpuQueue));
+    s.next = malloc(n * sizeof(int));
+    if (s.cpus == NULL || s.next == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    multicore_assign_host_cpus(&s);
+
+    // Set up SIGCHLD delivery and one quantum timer per CPU on a shared epoll set
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &s.old_mask);
+    s.signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    s.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (s.signal_fd == -1 || s.epoll_fd == -1) {
+        perror("dispatcher"); // Print error if an event source cannot be created
+        exit(1);
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = num_cpus; // Tags the signal fd, CPU timers are tagged with their index
+    epoll_ctl(s.epoll_fd, EPOLL_CTL_ADD, s.signal_fd, &event);
+
+    for (int c = 0; c < num_cpus; c++) {
+        CpuQueue* cpu = &s.cpus[c];
+        runqueue_init(&cpu->queue);
+        cpu->running = -1;
+        cpu->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (cpu->timer_fd == -1) {
+            perror("timerfd_create"); // Print error if the timer cannot be created
+            exit(1);
+        }
+        event.data.u32 = c;
+        epoll_ctl(s.epoll_fd, EPOLL_CTL_ADD, cpu->timer_fd, &event);
+    }
+
+    // Initialize all processes
+    for (int i = 0; i < n; i++) {
+        processes[i].arrival_time = 0;  // Set arrival time to 0 for all processes
+        processes[i].start_time = 0;    // Initialize start time
+        processes[i].completion_time = 0; // Initialize completion time
+        processes[i].burst_time = 0;     // Initialize burst time
+        processes[i].error = 0;           // Initialize error status
+        processes[i].output_fd = -1;      // Output pipe is created when the process starts
+        processes[i].sink_fd = -1;
+        processes[i].completed = 0;       // Mark process as not completed
+        processes[i].started = 0;         // Mark process as not started
+        processes[i].current_queue = 0;   // Initialize queue to 0
+        processes[i].time_in_queue = 0;   // Initialize time in queue
+        processes[i].migrations = 0;      // Not moved between CPUs yet
+
+        multicore_enqueue(&s, i % num_cpus, i); // Deal processes over the CPUs
+    }
+
+    output_begin();
+    s.origin = get_current_time_ns();
+    for (int c = 0; c < num_cpus; c++) {
+        multicore_switch_in(&s, c);
+    }
+
+    while (s.completed < n) {
+        struct epoll_event events[64];
+        int ready = epoll_wait(s.epoll_fd, events, 64, -1);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait"); // Print error if waiting for events fails
+            exit(1);
+        }
+
+        for (int e = 0; e < ready; e++) {
+            int tag = events[e].data.u32;
+            if (tag == num_cpus) {
+                struct signalfd_siginfo info;
+                while (read(s.signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                    // Drain every queued SIGCHLD, waitpid tells which child exited
                 }
-                processes[i].switch_time=current_time;
-                // Print process information after every context switch
-                printf("%s|%lu|%lu\n", processes[i].command, processes[i].switchinto_time, processes[i].switch_time);
-
-                // Boost processes to the highest priority queue after time S
-                if (current_time - last_boost_time >= S) {
-                    for (int i = 0; i < n; i++) {
-                        if (!processes[i].completed) {
-                            processes[i].current_queue = 0; // Move process to highest priority queue
-                            processes[i].time_in_queue = 0; // Reset time in queue
+                int status;
+                pid_t pid;
+                while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                    for (int c = 0; c < num_cpus; c++) {
+                        if (s.cpus[c].running != -1 && processes[s.cpus[c].running].pid == pid) {
+                            multicore_switch_out(&s, c, 1);
+                            break;
                         }
                     }
-                    last_boost_time = current_time; // Update last boost time
                 }
+            } else if (tag > num_cpus) {
+                // Output of the process running on a CPU
+                CpuQueue* cpu = &s.cpus[tag - num_cpus - 1];
+                if (cpu->running != -1 && output_pump(&processes[cpu->running]) == 0) {
+                    epoll_ctl(s.epoll_fd, EPOLL_CTL_DEL, processes[cpu->running].output_fd, NULL); // Writers are gone
+                }
+            } else {
+                uint64_t expirations;
+                CpuQueue* cpu = &s.cpus[tag];
+                if (read(cpu->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations) || cpu->running == -1) {
+                    continue; // Stale expiry of a quantum whose process already exited
+                }
+                pid_t pid = processes[cpu->running].pid;
+                kill(pid, SIGSTOP); // Stop the process
+                int status;
+                // The process may have exited right before it was stopped
+                multicore_switch_out(&s, tag, waitpid(pid, &status, WNOHANG) == pid);
             }
         }
+
+        // Boost processes to the highest priority queue after time S
+        if (policy == POLICY_MLFQ && get_current_time_ns() - s.origin - s.last_boost >= s.boost_time) {
+            multicore_boost(&s);
+            s.last_boost = get_current_time_ns() - s.origin; // Update last boost time
+        }
+
+        // Give every idle CPU the chance to pick up or steal work
+        for (int c = 0; c < num_cpus; c++) {
+            if (s.cpus[c].running == -1) {
+                multicore_switch_in(&s, c);
+            }
+        }
+    }
+
+    for (int c = 0; c < num_cpus; c++) {
+        close(s.cpus[c].timer_fd);
     }
+    close(s.epoll_fd);
+    close(s.signal_fd);
+    sigprocmask(SIG_SETMASK, &s.old_mask, NULL); // Restore the caller's signal mask
+    output_end();
+
+    multicore_write_results(&s, name);
+    free(s.cpus);
+    free(s.next);
+}
+
+// Function to execute processes using FCFS on every CPU of a multi-core run
+void MultiCoreFCFS(Process processes[], int n, int num_cpus) {
+    multicore_run(processes, n, POLICY_FCFS, NULL, 0, num_cpus, "FCFS");
+}
+
+// Function to execute processes using Round-Robin on every CPU of a multi-core run
+void MultiCoreRoundRobin(Process processes[], int n, int quantum, int num_cpus) {
+    int quanta[NUM_QUEUES] = {quantum, quantum, quantum};
+    multicore_run(processes, n, POLICY_RR, quanta, 0, num_cpus, "RR");
+}
+
+// Function to execute processes using MLFQ on every CPU of a multi-core run
+void MultiCoreMultiLevelFeedbackQueue(Process processes[], int n, int quantum0, int quantum1, int quantum2, int S, int num_cpus) {
+    int quanta[NUM_QUEUES] = {quantum0, quantum1, quantum2};
+    multicore_run(processes, n, POLICY_MLFQ, quanta, S, num_cpus, "MLFQ");
+}
 
-    // Write results to CSV file
-    FILE *fp = fopen("result_offline_MLFQ.csv", "w");
+// Discrete-event simulation of the offline policies
+// A trace gives the arrival and burst time of every job. The policies run against a
+// virtual clock that jumps from one event to the next, with no fork and no sleep, and
+// produce the same metrics, CSV columns and histograms as a real run. Context switches
+// cost nothing. Trace times are read in milliseconds and kept in nanoseconds.
+
+// Function to load a trace with one "command,arrival_ms,burst_ms" line per job
+// The command may itself contain commas, the last two fields are the times.
+// Empty lines and lines starting with '#' are skipped. Returns NULL if the file cannot be read.
+Process* load_trace(const char* path, int* n) {
+    FILE* fp = fopen(path, "r");
     if (fp == NULL) {
-        perror("Error opening file"); // Print error if file opening fails
-        exit(1);
+        perror("Error opening trace"); // Print error if file opening fails
+        return NULL;
     }
 
-    // Write CSV header
-    fprintf(fp, "Command,Finished,Error,Burst Time,Turnaround Time,Waiting Time,Response Time\n");
+    Process* processes = NULL;
+    int capacity = 0;
+    *n = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    while ((len = getline(&line, &line_size, fp)) != -1) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        char* burst = strrchr(line, ',');
+        if (burst == NULL) continue;
+        *burst++ = '\0';
+        char* arrival = strrchr(line, ',');
+        if (arrival == NULL) continue;
+        *arrival++ = '\0';
+
+        if (*n == capacity) {
+            capacity = capacity ? 2 * capacity : MAX_PROCESSES;
+            processes = realloc(processes, capacity * sizeof(Process));
+            if (processes == NULL) {
+                perror("malloc failed"); // Print error if memory allocation fails
+                exit(1);
+            }
+        }
+        Process* p = &processes[(*n)++];
+        memset(p, 0, sizeof(Process));
+        p->command = strdup(line);
+        p->arrival_time = strtoull(arrival, NULL, 10) * NS_PER_MS;
+        p->burst_time = strtoull(burst, NULL, 10) * NS_PER_MS; // Service the job needs
+        p->output_fd = p->sink_fd = -1;
+    }
+    free(line);
+    fclose(fp);
+    return processes;
+}
 
-    // Write process information to CSV
+// Function to sort process indices by arrival time, keeping trace order among equal arrivals
+int* simulation_arrival_order(Process processes[], int n) {
+    int* order = malloc(n * sizeof(int));
+    int* tmp = malloc(n * sizeof(int));
+    if (order == NULL || tmp == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) order[i] = i;
+
+    // Bottom-up merge sort, stable and O(n log n) for large traces
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int a = lo, b = mid, k = lo;
+            while (a < mid && b < hi) {
+                tmp[k++] = processes[order[b]].arrival_time < processes[order[a]].arrival_time ? order[b++] : order[a++];
+            }
+            while (a < mid) tmp[k++] = order[a++];
+            while (b < hi) tmp[k++] = order[b++];
+        }
+        int* swap = order;
+        order = tmp;
+        tmp = swap;
+    }
+    free(tmp);
+    return order;
+}
+
+// Function to reset the simulated state of every process
+// Returns the service each process needs, taken from its trace burst time.
+uint64_t* simulation_begin(Process processes[], int n) {
+    uint64_t* remaining = malloc(n * sizeof(uint64_t));
+    if (remaining == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    metrics_reset();
     for (int i = 0; i < n; i++) {
-        fprintf(fp, "%s,%s,%s,%lu,%lu,%lu,%lu\n", 
-                processes[i].command, 
-                processes[i].error ? "No" : "Yes",
-                processes[i].error ? "Yes" : "No",
-                processes[i].burst_time, 
-                processes[i].turnaround_time, 
-                processes[i].waiting_time, 
-                processes[i].response_time);
+        remaining[i] = processes[i].burst_time;
+        processes[i].start_time = 0;
+        processes[i].completion_time = 0;
+        processes[i].error = 0;
+        processes[i].completed = 0;
+        processes[i].started = 0;
+        processes[i].current_queue = 0;
+        processes[i].time_in_queue = 0;
     }
+    return remaining;
+}
+
+// Function to simulate First-Come, First-Served (FCFS) scheduling of a trace
+void SimulateFCFS(Process processes[], int n, const char* csv_path) {
+    int* order = simulation_arrival_order(processes, n);
+    uint64_t* remaining = simulation_begin(processes, n);
+    uint64_t current_time = 0; // Virtual clock
 
-    fclose(fp); // Close the file
+    for (int k = 0; k < n; k++) {
+        Process* p = &processes[order[k]];
+        if (current_time < p->arrival_time) {
+            current_time = p->arrival_time; // Idle until the next arrival
+        }
+        p->start_time = current_time;
+        p->started = 1;
+        current_time += remaining[order[k]];
+        p->completion_time = current_time;
+        p->completed = 1;
+        calculate_time_metrics(p);
+    }
+
+    write_results(csv_path ? csv_path : "result_offline_sim_FCFS.csv", processes, n);
+    free(order);
+    free(remaining);
 }
 
+// Function to simulate the RR and MLFQ policies of a trace with a virtual clock
+// RR is MLFQ with one level and no boost: a process that uses its whole quantum goes
+// to the tail of the next level (the same level for RR), arrivals join level 0 ahead of it.
+// Every quantum must be positive: a slice of no virtual time would never finish a process.
+void simulate_feedback_queue(Process processes[], int n, const int* quantum, int levels, uint64_t boost_time, const char* csv_path) {
+    for (int level = 0; level < levels; level++) {
+        if (quantum[level] <= 0) {
+            fprintf(stderr, "Invalid quantum %d ms for queue %d, quanta must be positive\n", quantum[level], level);
+            return;
+        }
+    }
+    int* order = simulation_arrival_order(processes, n);
+    uint64_t* remaining = simulation_begin(processes, n);
+    int* next = malloc(n * sizeof(int));
+    if (next == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    RunQueue queue;
+    runqueue_init(&queue);
+
+    uint64_t current_time = 0;     // Virtual clock
+    uint64_t last_boost_time = 0;  // Track last boost time
+    int arrived = 0;               // Processes of order[] already admitted
+    int completed = 0;
 
+    while (completed < n) {
+        // Admit everything that has arrived by now
+        while (arrived < n && processes[order[arrived]].arrival_time <= current_time) {
+            runqueue_push(&queue, next, 0, order[arrived++]);
+        }
+        if (queue.waiting == 0) {
+            current_time = processes[order[arrived]].arrival_time; // Idle until the next arrival
+            continue;
+        }
+
+        int i = runqueue_pop_process(&queue, next, processes);
+        Process* p = &processes[i];
+        if (!p->started) {
+            p->start_time = current_time; // Set start time for the process
+            p->started = 1;
+        }
+
+        uint64_t slice = (uint64_t)quantum[p->current_queue] * NS_PER_MS;
+        if (slice > remaining[i]) slice = remaining[i];
+        current_time += slice;
+        remaining[i] -= slice;
+        p->time_in_queue += slice;
+
+        while (arrived < n && processes[order[arrived]].arrival_time <= current_time) {
+            runqueue_push(&queue, next, 0, order[arrived++]);
+        }
+
+        if (remaining[i] > 0) {
+            if (p->current_queue < levels - 1) {
+                p->current_queue++; // Move to next lower priority queue
+                p->time_in_queue = 0;
+            }
+            runqueue_push(&queue, next, p->current_queue, i);
+        } else {
+            p->completed = 1;
+            p->completion_time = current_time;
+            completed++;
+            calculate_time_metrics(p);
+        }
+
+        // Boost processes to the highest priority queue after time S
+        if (levels > 1 && current_time - last_boost_time >= boost_time * NS_PER_MS) {
+            runqueue_boost(&queue, next);
+            last_boost_time = current_time;
+        }
+    }
+
+    write_results(csv_path, processes, n);
+    free(order);
+    free(remaining);
+    free(next);
+}
+
+// Function to simulate Round-Robin (RR) scheduling of a trace
+void SimulateRoundRobin(Process processes[], int n, int quantum, const char* csv_path) {
+    int quanta[1] = {quantum};
+    simulate_feedback_queue(processes, n, quanta, 1, 0, csv_path ? csv_path : "result_offline_sim_RR.csv");
+}
+
+// Function to simulate Multi-Level Feedback Queue (MLFQ) scheduling of a trace
+void SimulateMultiLevelFeedbackQueue(Process processes[], int n, int quantum0, int quantum1, int quantum2, int S, const char* csv_path) {
+    int quanta[NUM_QUEUES] = {quantum0, quantum1, quantum2};
+    simulate_feedback_queue(processes, n, quanta, NUM_QUEUES, S, csv_path ? csv_path : "result_offline_sim_MLFQ.csv");
+}
@@ -6,14 +6,19 @@
 #include <unistd.h>     // For POSIX operating system API (e.g., fork, pipe)
 #include <sys/wait.h>   // For process wait functions (e.g., waitpid)
 #include <signal.h>     // For signal handling (e.g., kill)
-#include <sys/time.h>   // For time functions (e.g., gettimeofday)
 #include <stdbool.h>    // For boolean type (e.g., true, false)
 #include <string.h>     // For string manipulation (e.g., strtok, strcpy)
 #include <fcntl.h>      // For file control options (e.g., fcntl)
 #include <stdint.h>     // For fixed-width integer types (e.g., uint64_t)
+#include <errno.h>      // For error numbers (e.g., EAGAIN)
+#include <sys/epoll.h>  // For waiting on several file descriptors (e.g., epoll_wait)
+#include <sys/signalfd.h> // For receiving SIGCHLD as a file descriptor (e.g., signalfd)
+#include "scheduler_metrics.h" // For the monotonic clock, result writer and histograms
 
-#define MAX_PROCESSES 100   // Maximum number of processes supported
+#define MAX_PROCESSES 100   // Initial capacity of the process and command tables, both grow as needed
 #define COMMAND_LENGTH 1000 // Maximum length of a command string
+#define DEFAULT_BURST_TIME (1000 * NS_PER_MS) // Predicted burst time of a command never run before
+#define INPUT_BUFFER_SIZE 4096  // Bytes of stdin buffered while a line is incomplete
 
 // Global variable to keep track of the number of commands
 int map_size = 0;
@@ -21,81 +26,324 @@ int map_size = 0;
 // Define the Process structure
 typedef struct {
     char *command;              // Command to be executed
-    uint64_t start_time;       // Start time of the process in milliseconds
-    uint64_t burst_time;  // Completion time of the process in milliseconds
+    uint64_t start_time;       // Start time of the process in nanoseconds
+    uint64_t burst_time;  // Completion time of the process in nanoseconds
     uint64_t turnaround_time;  // Turnaround time (completion time - arrival time)
     uint64_t waiting_time;     // Waiting time (start time - arrival time)
     uint64_t response_time;    // Response time (waiting time)
     int completed;             // Flag indicating if the process is completed
     int error;                 // Flag indicating if there was an error in execution
-    int command_id;            // Unique identifier for the command
+    int command_id;            // Index of the command in command_map
+    uint64_t command_hash;     // Hash of the command string, computed once at arrival
+    int next_pending;          // Next pending process of the same command, -1 at the tail
 } Process;
 
 // Function prototypes
 void ShortestJobFirst();
 void ShortestRemainingTimeFirst();
 void MultiLevelFeedbackQueue(int quantum0, int quantum1, int quantum2, int boostTime);
+void SimulateShortestJobFirst(const char *trace_path, const char *csv_path);
+void SimulateShortestRemainingTimeFirst(const char *trace_path, const char *csv_path);
 
 // Define the Command structure
 typedef struct {
-    char command[COMMAND_LENGTH]; // Command string
-    int index;                    // Index of the command in the command_map
-    uint64_t burst_time;          // Average burst time of the command
+    char *command;                // Command string
+    uint64_t hash;                // Hash of the command string
+    uint64_t burst_time;          // Predicted burst time of the command
     int count;                    // Number of times the command has been executed
+    int pending_head;             // Oldest pending process running this command, -1 if none
+    int pending_tail;             // Newest pending process running this command, -1 if none
+    int heap_pos;                 // Position in pending_heap, -1 if nothing is pending
 } Command;
 
-// Array to store the commands
-Command command_map[MAX_PROCESSES];
+// Array to store the commands, grown as new commands arrive
+Command *command_map = NULL;
+int map_capacity = 0;
+
+// Open addressing hash table from command string to its index in command_map
+int *command_table = NULL;  // -1 marks an empty slot
+int command_table_size = 0; // Power of two
+
+// Weight of the newest burst in the predictor, 0 keeps a plain running average
+double burst_predictor_alpha = 0.0;
+
+// Function to select how burst times are predicted from earlier runs
+// alpha in (0, 1] uses an exponentially weighted moving average, 0 the running average.
+void set_burst_predictor(double alpha) {
+    burst_predictor_alpha = (alpha > 0.0 && alpha <= 1.0) ? alpha : 0.0;
+}
+
+// Function to hash a command string (64-bit FNV-1a)
+uint64_t hash_command(const char *command) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = command; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Function to find the slot of a command in the hash table, or the empty slot where it belongs
+int command_slot(const char *command, uint64_t hash) {
+    int mask = command_table_size - 1;
+    int slot = (int)(hash & mask);
+    while (command_table[slot] != -1) {
+        Command *c = &command_map[command_table[slot]];
+        if (c->hash == hash && strcmp(c->command, command) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
 
 // Function to find the index of a command in the command map
-int command_index(char *command) {
-    for (int i = 0; i < map_size; i++) {
-        if (strcmp(command_map[i].command, command) == 0) {
-            return command_map[i].index; // Return the index if command is found
+int command_index(const char *command, uint64_t hash) {
+    if (command_table_size == 0) return -1;
+    return command_table[command_slot(command, hash)]; // -1 if command is not found
+}
+
+// Function to find the predicted burst time of a command
+uint64_t command_burst_time(const char *command, uint64_t hash) {
+    int idx = command_index(command, hash);
+    return idx == -1 ? DEFAULT_BURST_TIME : command_map[idx].burst_time; // Default burst time if command is not found
+}
+
+// Function to add a new command to the command map and return its index
+int append_command(const char *command, uint64_t hash) {
+    // Keep the hash table at most half full, rehashing into a table twice the size
+    if (2 * (map_size + 1) > command_table_size) {
+        int new_size = command_table_size ? 2 * command_table_size : 2 * MAX_PROCESSES;
+        while (new_size & (new_size - 1)) new_size++; // Round up to a power of two
+        free(command_table);
+        command_table = malloc(new_size * sizeof(int));
+        if (command_table == NULL) {
+            perror("malloc failed"); // Print error if memory allocation fails
+            exit(1);
+        }
+        memset(command_table, -1, new_size * sizeof(int));
+        command_table_size = new_size;
+        for (int i = 0; i < map_size; i++) {
+            command_table[command_slot(command_map[i].command, command_map[i].hash)] = i;
         }
     }
-    return -1; // Return -1 if command is not found
+    if (map_size == map_capacity) {
+        map_capacity = map_capacity ? 2 * map_capacity : MAX_PROCESSES;
+        command_map = realloc(command_map, map_capacity * sizeof(Command));
+        if (command_map == NULL) {
+            perror("malloc failed"); // Print error if memory allocation fails
+            exit(1);
+        }
+    }
+
+    Command *c = &command_map[map_size];
+    c->command = strdup(command);
+    c->hash = hash;
+    c->burst_time = DEFAULT_BURST_TIME;  // Default burst time for new commands
+    c->count = 0; // Initialize count
+    c->pending_head = c->pending_tail = -1;
+    c->heap_pos = -1;
+    command_table[command_slot(command, hash)] = map_size;
+    return map_size++; // Increment map size
+}
+
+// Function to fold a measured burst time into the prediction for a command
+void update_command_burst_time(int idx, uint64_t burst_time) {
+    Command *c = &command_map[idx];
+    if (c->count == 0) {
+        c->burst_time = burst_time; // First measurement replaces the default
+    } else if (burst_predictor_alpha > 0.0) {
+        c->burst_time = (uint64_t)(burst_predictor_alpha * burst_time + (1.0 - burst_predictor_alpha) * c->burst_time);
+    } else {
+        c->burst_time = (c->burst_time * c->count + burst_time) / (c->count + 1);
+    }
+    c->count++;
 }
 
-// Function to find the burst time of a command
-uint64_t command_burst_time(char *command) {
+// Min-heap of the commands that have pending processes, keyed on predicted burst time
+// All pending processes of one command share its prediction, so they wait in arrival
+// order on the command and only the command itself sits in the heap. Ties go to the
+// command whose oldest pending process arrived first.
+int *pending_heap = NULL;
+int pending_heap_size = 0;
+int pending_heap_capacity = 0;
+
+// Function to forget every command and pending process, e.g. between simulated runs
+void reset_command_map() {
     for (int i = 0; i < map_size; i++) {
-        if (strcmp(command_map[i].command, command) == 0) {
-            return command_map[i].burst_time; // Return the burst time if command is found
+        free(command_map[i].command);
+    }
+    free(command_map);
+    free(command_table);
+    command_map = NULL;
+    command_table = NULL;
+    map_size = map_capacity = command_table_size = 0;
+    pending_heap_size = 0;
+}
+
+// Function to check whether command a should run before command b
+bool pending_before(int a, int b) {
+    Command *ca = &command_map[a];
+    Command *cb = &command_map[b];
+    if (ca->burst_time != cb->burst_time) {
+        return ca->burst_time < cb->burst_time;
+    }
+    return ca->pending_head < cb->pending_head;
+}
+
+// Function to place a command at a heap position and record it there
+void pending_heap_set(int pos, int idx) {
+    pending_heap[pos] = idx;
+    command_map[idx].heap_pos = pos;
+}
+
+// Function to restore the heap order around a command whose key may have changed
+void pending_heap_fix(int pos) {
+    int idx = pending_heap[pos];
+    while (pos > 0 && pending_before(idx, pending_heap[(pos - 1) / 2])) {
+        pending_heap_set(pos, pending_heap[(pos - 1) / 2]); // Move the parent down
+        pos = (pos - 1) / 2;
+    }
+    while (1) {
+        int child = 2 * pos + 1;
+        if (child >= pending_heap_size) break;
+        if (child + 1 < pending_heap_size && pending_before(pending_heap[child + 1], pending_heap[child])) {
+            child++;
         }
+        if (!pending_before(pending_heap[child], idx)) break;
+        pending_heap_set(pos, pending_heap[child]); // Move the smaller child up
+        pos = child;
     }
-    return 1000;  // Return default burst time if command is not found
+    pending_heap_set(pos, idx);
 }
 
-// Function to add a new command to the command map
-void append_command(char *command, int index) {
-    if (map_size < MAX_PROCESSES) {
-        strncpy(command_map[map_size].command, command, COMMAND_LENGTH - 1);
-        command_map[map_size].command[COMMAND_LENGTH - 1] = '\0'; // Null-terminate the command string
-        command_map[map_size].index = index; // Set the command index
-        command_map[map_size].burst_time = 1000;  // Default burst time for new commands
-        command_map[map_size].count = 0; // Initialize count
-        map_size++; // Increment map size
+// Function to add a pending process to its command, queuing the command if needed
+void pending_push(Process processes[], int i) {
+    Command *c = &command_map[processes[i].command_id];
+    processes[i].next_pending = -1;
+    if (c->pending_tail == -1) {
+        c->pending_head = i;
     } else {
-        fprintf(stderr, "No more space\n"); // Print error if the map is full
+        processes[c->pending_tail].next_pending = i;
+    }
+    c->pending_tail = i;
+
+    if (c->heap_pos == -1) {
+        if (pending_heap_size == pending_heap_capacity) {
+            pending_heap_capacity = pending_heap_capacity ? 2 * pending_heap_capacity : MAX_PROCESSES;
+            pending_heap = realloc(pending_heap, pending_heap_capacity * sizeof(int));
+            if (pending_heap == NULL) {
+                perror("malloc failed"); // Print error if memory allocation fails
+                exit(1);
+            }
+        }
+        pending_heap_set(pending_heap_size++, processes[i].command_id);
+        pending_heap_fix(pending_heap_size - 1);
+    }
+}
+
+// Function to look up the command of a newly arrived process and queue it as pending
+void admit_process(Process processes[], int i) {
+    Process *p = &processes[i];
+    p->command_hash = hash_command(p->command); // Hash once, reused by every lookup
+
+    // Add command to the command map if it's not already present
+    p->command_id = command_index(p->command, p->command_hash);
+    if (p->command_id == -1) {
+        p->command_id = append_command(p->command, p->command_hash);
+    }
+    pending_push(processes, i); // Queue by predicted burst time
+}
+
+// Function to record the measured burst of a finished process in its command's prediction
+void complete_process(Process *p) {
+    update_command_burst_time(p->command_id, p->burst_time);
+    Command *c = &command_map[p->command_id];
+    if (c->heap_pos != -1) {
+        pending_heap_fix(c->heap_pos); // Its other pending processes move with the new prediction
+    }
+}
+
+// Function to open a result file and write its CSV header
+ResultWriter *open_results(const char *path) {
+    ResultWriter *w = malloc(sizeof(ResultWriter));
+    if (w == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
     }
+    result_writer_open(w, path);
+    result_write_str(w, "Command,Finished,Error,Burst Time,Turnaround Time,Waiting Time,Response Time\n");
+    return w;
+}
+
+// Function to close a result file and write the histograms of the run next to it
+void close_results(ResultWriter *w, const char *path) {
+    result_writer_close(w);
+    free(w);
+    metrics_write(path);
+}
+
+// Function to write the metrics of one finished process as a CSV row, times in milliseconds
+// The row is buffered, and the times are added to the histograms of the run.
+void write_result_row(ResultWriter *w, const Process *p) {
+    result_write_str(w, p->command);
+    result_write_str(w, p->error ? ",No,Yes," : ",Yes,No,");
+    result_write_ms(w, p->burst_time);
+    result_write_char(w, ',');
+    result_write_ms(w, p->turnaround_time);
+    result_write_char(w, ',');
+    result_write_ms(w, p->waiting_time);
+    result_write_char(w, ',');
+    result_write_ms(w, p->response_time);
+    result_write_char(w, '\n');
+    metrics_record_process(p->turnaround_time, p->waiting_time, p->response_time);
 }
 
-// Function to get the current time in milliseconds
-uint64_t get_current_time_ms() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL); // Get the current time
-    return (uint64_t)(tv.tv_sec) * 1000 + (uint64_t)(tv.tv_usec) / 1000; // Convert to milliseconds
+// Function to remove the pending process with the shortest predicted burst, -1 if none
+int pending_pop(Process processes[]) {
+    if (pending_heap_size == 0) return -1;
+    int idx = pending_heap[0];
+    Command *c = &command_map[idx];
+    int i = c->pending_head;
+    c->pending_head = processes[i].next_pending;
+
+    if (c->pending_head == -1) {
+        // Nothing left for this command, take it out of the heap
+        c->pending_tail = -1;
+        c->heap_pos = -1;
+        pending_heap_size--;
+        if (pending_heap_size > 0) {
+            pending_heap_set(0, pending_heap[pending_heap_size]);
+            pending_heap_fix(0);
+        }
+    } else {
+        pending_heap_fix(0); // Its tie-break moved to a later arrival
+    }
+    return i;
 }
 
-// Function to execute a command and manage pipes and process creation
-int execute_command(char* command, pid_t* pid, int* pipefd) {
+// Function to start a command with its output sent to a pipe, without waiting for it
+// Returns once the child has exec'd or failed to, so the caller can wait for its exit
+// together with other events. Returns -1 if the command could not be started; *pid is
+// -1 and no pipe is left open if no child was created.
+int start_command(char* command, pid_t* pid, int* pipefd) {
     int status_pipe[2];
+    *pid = -1; // No child until the fork succeeds
+    pipefd[0] = pipefd[1] = -1;
     // Create two pipes: one for standard output and error, and one for status
-    if (pipe(pipefd) == -1 || pipe(status_pipe) == -1) {
+    if (pipe(pipefd) == -1) {
         perror("pipe"); // Print error if pipe creation fails
         return -1;
     }
+    if (pipe(status_pipe) == -1) {
+        perror("pipe"); // Print error if pipe creation fails
+        close(pipefd[0]);
+        close(pipefd[1]);
+        pipefd[0] = pipefd[1] = -1;
+        return -1;
+    }
+    fcntl(pipefd[0], F_SETFD, FD_CLOEXEC); // Keep the read end out of later children
+    fcntl(status_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(status_pipe[1], F_SETFD, FD_CLOEXEC); // A successful exec closes the status pipe
 
     *pid = fork(); // Create a new process
     if (*pid == 0) {
@@ -106,6 +354,12 @@ int execute_command(char* command, pid_t* pid, int* pipefd) {
         dup2(pipefd[1], STDERR_FILENO); // Redirect standard error to the pipe
         close(pipefd[1]); // Close the write end of the pipe
 
+        // The scheduler blocks SIGCHLD to read it from a signalfd, do not pass that on
+        sigset_t chld_mask;
+        sigemptyset(&chld_mask);
+        sigaddset(&chld_mask, SIGCHLD);
+        sigprocmask(SIG_UNBLOCK, &chld_mask, NULL);
+
         // Count the number of arguments in the command
         int arg_count = 1;
         for (int i = 0; command[i]; i++) {
@@ -137,133 +391,544 @@ int execute_command(char* command, pid_t* pid, int* pipefd) {
 
         free(args);  // Free allocated memory
         perror("execvp failed"); // Print error if execvp fails
-        exit(EXIT_FAILURE);
+        _exit(EXIT_FAILURE); // Do not flush stdio buffers inherited from the scheduler
     } else if (*pid < 0) {
         perror("fork failed"); // Print error if fork fails
+        close(pipefd[0]);
+        close(pipefd[1]);
+        close(status_pipe[0]);
+        close(status_pipe[1]);
+        *pid = -1;
+        pipefd[0] = pipefd[1] = -1;
         return -1;
     } else {
         // Parent process
         close(pipefd[1]); // Close the write end of the pipe
         close(status_pipe[1]); // Close the write end of the status pipe
 
-        // Wait for the child process to finish
-        int status;
-        waitpid(*pid, &status, 0);  // This will block until the child completes
-
-        if (WIFEXITED(status)) {
-            // Check if the child process exited normally
-            int error_status = 0;
-            read(status_pipe[0], &error_status, sizeof(error_status)); // Read the error status
-            close(status_pipe[0]); // Close the read end of the status pipe
-            return error_status == 0 ? 0 : -1; // Return 0 if no error, -1 otherwise
+        // The read returns at the exec (EOF) or when the child reports a failure
+        int error_status = 0;
+        if (read(status_pipe[0], &error_status, sizeof(error_status)) != sizeof(error_status)) {
+            error_status = 0; // Status pipe closed by exec, no error
+        }
+        close(status_pipe[0]); // Close the read end of the status pipe
+        return error_status == 0 ? 0 : -1; // Return 0 if no error, -1 otherwise
+    }
+}
+
+// Event sources of an online scheduler, all waited on in a single epoll_wait
+typedef struct {
+    int epoll_fd;        // Waits on stdin, signal_fd and the running command's output
+    int signal_fd;       // Readable when a child changes state (SIGCHLD)
+    sigset_t old_mask;   // Signal mask to restore when the loop is closed
+    int stdin_polled;    // 0 if stdin cannot be polled (a regular file) and is read directly
+    int stdin_eof;       // Set once stdin is exhausted
+    char input[INPUT_BUFFER_SIZE]; // Bytes of an incomplete line
+    size_t input_len;
+} OnlineLoop;
+
+// Function to set up the event sources of an online scheduler
+void online_loop_init(OnlineLoop* loop) {
+    memset(loop, 0, sizeof(*loop));
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &loop->old_mask); // SIGCHLD is delivered through signal_fd only
+
+    loop->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->signal_fd == -1 || loop->epoll_fd == -1) {
+        perror("event loop"); // Print error if an event source cannot be created
+        exit(1);
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = loop->signal_fd;
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->signal_fd, &event);
+
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK); // Set stdin to non-blocking mode
+    event.data.fd = STDIN_FILENO;
+    loop->stdin_polled = epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &event) == 0;
+}
+
+// Function to release the event sources of an online scheduler
+void online_loop_close(OnlineLoop* loop) {
+    close(loop->epoll_fd);
+    close(loop->signal_fd);
+    sigprocmask(SIG_SETMASK, &loop->old_mask, NULL); // Restore the caller's signal mask
+}
+
+// Function to read whatever stdin has available and hand every complete line to admit
+// admit returns 0 to stop reading, e.g. after an exit line. Returns 0 once reading stopped.
+int online_loop_read_stdin(OnlineLoop* loop, int (*admit)(char* line, void* ctx), void* ctx) {
+    while (!loop->stdin_eof) {
+        ssize_t n = read(STDIN_FILENO, loop->input + loop->input_len, sizeof(loop->input) - loop->input_len - 1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 1; // Drained for now
+            n = 0; // Treat a read error like the end of input
+        }
+        if (n == 0) {
+            loop->stdin_eof = 1;
+            if (loop->input_len == 0) break;
+            loop->input[loop->input_len++] = '\n'; // The last line had no newline
         } else {
-            close(status_pipe[0]); // Close the read end of the status pipe
-            return -1;  // Return -1 if the child didn't exit normally
+            loop->input_len += n;
         }
+
+        // Admit every complete line, keeping an incomplete tail for the next read
+        char* line = loop->input;
+        char* newline;
+        while ((newline = memchr(line, '\n', loop->input + loop->input_len - line)) != NULL) {
+            *newline = '\0';
+            if (!admit(line, ctx)) {
+                loop->stdin_eof = 1;
+                break;
+            }
+            line = newline + 1;
+        }
+        size_t rest = loop->input + loop->input_len - line;
+        if (loop->stdin_eof) {
+            rest = 0;
+        } else if (rest == sizeof(loop->input) - 1) {
+            loop->input[rest] = '\0'; // Line longer than the buffer, admit what fits
+            if (!admit(loop->input, ctx)) loop->stdin_eof = 1;
+            rest = 0;
+        }
+        memmove(loop->input, line, rest);
+        loop->input_len = rest;
+    }
+    if (loop->stdin_polled) {
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+        loop->stdin_polled = 0;
+    }
+    return 0;
+}
+
+// State of a Shortest Job First run shared with the stdin line handler
+typedef struct {
+    Process *processes;       // Array to store processes, grown as they arrive
+    int process_capacity;     // Number of processes the array can hold
+    int process_number;       // Count of processes
+    int exiting;              // Set once an exit line has been read
+} SJFState;
+
+// Function to admit one line of stdin as a new process, returns 0 on exit
+int sjf_admit(char *line, void *ctx) {
+    SJFState *state = ctx;
+
+    // Exit condition
+    if (strcmp(line, "exit") == 0) {
+        state->exiting = 1;
+        return 0;
+    }
+    if (line[0] == '\0') {
+        return 1; // Nothing to run
     }
+
+    if (state->process_number == state->process_capacity) {
+        state->process_capacity = state->process_capacity ? 2 * state->process_capacity : MAX_PROCESSES;
+        state->processes = realloc(state->processes, state->process_capacity * sizeof(Process));
+        if (state->processes == NULL) {
+            perror("malloc failed"); // Print error if memory allocation fails
+            exit(1);
+        }
+    }
+
+    // Store the process information
+    Process *p = &state->processes[state->process_number];
+    p->command = strdup(line); // Duplicate the command
+    p->start_time = get_current_time_ns(); // Record arrival time as soon as the line is read
+    p->completed = 0; // Mark as not completed
+    p->error = 0; // No error initially
+    admit_process(state->processes, state->process_number); // Queue by predicted burst time
+
+    state->process_number++; // Increment process number
+    return 1;
+}
+
+// Function to record a finished process of an online run, returns its end time
+// Prints it, updates its command's prediction and writes its row to the CSV file.
+uint64_t finish_online_process(Process *p, uint64_t start_time, uint64_t arrival_time, ResultWriter *results) {
+    uint64_t end_time = get_current_time_ns(); // Record end time
+    p->burst_time = end_time - start_time; // Calculate completion time
+    p->turnaround_time = end_time - p->start_time; // Calculate turnaround time
+    p->waiting_time = start_time - p->start_time; // Calculate waiting time
+    p->response_time = start_time - p->start_time; // Response time is same as waiting time
+    p->completed = 1; // Mark process as completed
+
+    // Print process information to stdout
+    printf("%s|%lu|%lu\n", p->command, (start_time - arrival_time) / NS_PER_MS, (end_time - arrival_time) / NS_PER_MS);
+    fflush(stdout); // Ensure stdout is flushed
+
+    // Update the command map with new burst time
+    complete_process(p);
+
+    // Write process information to the CSV file
+    write_result_row(results, p);
+    return end_time;
 }
 
 // Function to implement Shortest Job First (SJF) scheduling
+// A single epoll_wait covers stdin, child exit and the running command's output, so new
+// lines are admitted the moment they arrive and the scheduler sleeps while idle.
 void ShortestJobFirst() {
-    Process processes[MAX_PROCESSES]; // Array to store processes
-    int process_number = 0;          // Count of processes
-    char buffer_command[2048];       // Buffer to read commands from stdin
+    SJFState state;
+    memset(&state, 0, sizeof(state));
 
     // Open the CSV file to write results
-    FILE *fp = fopen("result_online_SJF.csv", "w");
-    if (fp == NULL) {
-        perror("Error opening file"); // Print error if file opening fails
-        exit(1);
-    }
-    fprintf(fp, "Command,Finished,Error,Burst Time,Turnaround Time,Waiting Time,Response Time\n");
+    metrics_reset();
+    ResultWriter *results = open_results("result_online_SJF.csv");
+
+    OnlineLoop loop;
+    online_loop_init(&loop);
+    uint64_t arrival_time = get_current_time_ns(); // Record the arrival time
 
-    fflush(fp);  // Ensure file is flushed after each write
-    // Set stdin to non-blocking mode
-    fcntl(STDIN_FILENO, F_SETFL, O_NONBLOCK);
-    uint64_t arrival_time = get_current_time_ms(); // Record the arrival time
+    int running = -1;          // Process being executed, -1 if none
+    pid_t running_pid = -1;
+    int output_fd = -1;        // Read end of the running command's output pipe
+    uint64_t start_time = 0;   // When the running command was started
+    uint64_t switch_from = 0;  // When the last command exited while others were pending, 0 if not
+
+    if (!loop.stdin_polled) {
+        online_loop_read_stdin(&loop, sjf_admit, &state); // A regular file never blocks, read it now
+    }
 
     while (1) {
-        // Read commands from stdin
-        while (fgets(buffer_command, sizeof(buffer_command), stdin)) {
-            buffer_command[strcspn(buffer_command, "\n")] = 0; // Remove newline character
-
-            // Exit condition
-            if (strcmp(buffer_command, "exit") == 0) {
-                fclose(fp); // Close the file
-                exit(0); // Exit the program
+        // Start the shortest pending job whenever nothing is running
+        while (running == -1 && !state.exiting) {
+            running = pending_pop(state.processes);
+            if (running == -1) break;
+            Process *p = &state.processes[running];
+            start_time = get_current_time_ns(); // Record start time
+            if (switch_from != 0) {
+                histogram_record(&scheduler_metrics.context_switch, start_time - switch_from);
+            }
+            int pipefd[2]; // Pipe for standard output and error
+            p->error = start_command(p->command, &running_pid, pipefd) == -1; // Start the command
+            if (running_pid == -1) {
+                // No child to wait for, the process is done and the next one is tried
+                running = -1;
+                switch_from = finish_online_process(p, start_time, arrival_time, results);
+                continue;
+            }
+            if (!p->error) {
+                histogram_record(&scheduler_metrics.spawn, get_current_time_ns() - start_time);
             }
+            output_fd = pipefd[0];
+            fcntl(output_fd, F_SETFL, O_NONBLOCK);
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = output_fd;
+            epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, output_fd, &event);
+        }
+        switch_from = 0; // Anything started later waited for input, not for the scheduler
+        if (running == -1 && (state.exiting || loop.stdin_eof)) {
+            break; // No more work can arrive
+        }
 
-            // Store the process information
-            processes[process_number].command = strdup(buffer_command); // Duplicate the command
-            processes[process_number].start_time = get_current_time_ms(); // Record start time
-            processes[process_number].completed = 0; // Mark as not completed
-            processes[process_number].error = 0; // No error initially
-            processes[process_number].command_id = process_number; // Set command ID
+        struct epoll_event events[4];
+        int ready = epoll_wait(loop.epoll_fd, events, 4, -1); // Sleep until something happens
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait"); // Print error if waiting for events fails
+            exit(1);
+        }
 
-            // Add command to the command map if it's not already present
-            if (command_index(buffer_command) == -1) {
-                append_command(buffer_command, process_number);
+        int child_event = 0;
+        for (int e = 0; e < ready; e++) {
+            int fd = events[e].data.fd;
+            if (fd == STDIN_FILENO) {
+                online_loop_read_stdin(&loop, sjf_admit, &state);
+            } else if (fd == loop.signal_fd) {
+                struct signalfd_siginfo info;
+                while (read(loop.signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                    // Drain every queued SIGCHLD, waitpid tells whether the running command exited
+                }
+                child_event = 1;
+            } else if (output_fd != -1 && fd == output_fd) {
+                char discard[4096];
+                ssize_t n;
+                while ((n = read(output_fd, discard, sizeof(discard))) > 0) {
+                    // Keep the pipe drained so a chatty command never blocks on it
+                }
+                if (n == 0) {
+                    // Writers closed the pipe, stop watching it so a hangup does not spin
+                    epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, output_fd, NULL);
+                    close(output_fd);
+                    output_fd = -1;
+                }
             }
-
-            process_number++; // Increment process number
         }
 
-        // Find the shortest job
-        int shortest_process = -1;
-        uint64_t shortest_time = UINT64_MAX;
-        for (int i = 0; i < process_number; i++) {
-            uint64_t burst = command_burst_time(processes[i].command);
-            if (!processes[i].completed && burst < shortest_time) {
-                shortest_time = burst; // Update shortest time
-                shortest_process = i; // Update index of shortest process
+        int status;
+        if (child_event && running != -1 && waitpid(running_pid, &status, WNOHANG) == running_pid) {
+            Process *p = &state.processes[running];
+            if (!WIFEXITED(status)) {
+                p->error = 1; // The child did not exit normally
+            }
+            if (output_fd != -1) {
+                epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, output_fd, NULL);
+                close(output_fd);
+                output_fd = -1;
             }
+            running = -1;
+            switch_from = finish_online_process(p, start_time, arrival_time, results); // The next pending command is started right away
         }
+    }
 
-        if (shortest_process != -1) {
-            Process *p = &processes[shortest_process];
-            uint64_t start_time = get_current_time_ms(); // Record start time
-            
-            pid_t pid;
-            int pipefd[2]; // Pipe for standard output and error
-            int error_status = execute_command(p->command, &pid, pipefd); // Execute the command
-            if (error_status == -1) {
-                p->error = 1; // Mark process as having an error
+    online_loop_close(&loop);
+    close_results(results, "result_online_SJF.csv"); // Close the file
+    exit(0); // Exit the program
+}
+
+// Discrete-event simulation of the online policies
+// A trace gives each job's command, arrival and actual burst time. Jobs are admitted
+// when the virtual clock reaches their arrival and scheduled on the same predicted
+// burst times as a real run, but no command is executed and nothing sleeps. Trace times
+// are read in milliseconds and kept in nanoseconds like measured ones.
+
+// Function to sort processes by arrival time, keeping trace order among equal arrivals
+void sort_by_arrival(Process *processes, int n) {
+    int sorted = 1;
+    for (int i = 1; i < n && sorted; i++) {
+        sorted = processes[i - 1].start_time <= processes[i].start_time;
+    }
+    if (sorted) return; // Traces are usually written in arrival order
+
+    Process *tmp = malloc(n * sizeof(Process));
+    if (tmp == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    // Bottom-up merge sort, stable and O(n log n) for large traces
+    Process *from = processes, *to = tmp;
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = lo + width < n ? lo + width : n;
+            int hi = lo + 2 * width < n ? lo + 2 * width : n;
+            int a = lo, b = mid, k = lo;
+            while (a < mid && b < hi) {
+                to[k++] = from[b].start_time < from[a].start_time ? from[b++] : from[a++];
             }
-            
-            uint64_t end_time = get_current_time_ms(); // Record end time
-            p->burst_time = end_time - start_time; // Calculate completion time
-            p->turnaround_time = end_time - p->start_time; // Calculate turnaround time
-            p->waiting_time = start_time - p->start_time; // Calculate waiting time
-            p->response_time = start_time - p->start_time; // Response time is same as waiting time
-            p->completed = 1; // Mark process as completed
-
-            // Print process information to stdout
-            printf("%s|%lu|%lu\n", p->command, start_time - arrival_time, end_time - arrival_time);
-            fflush(stdout); // Ensure stdout is flushed
-
-            // Update the command map with new burst time
-            int idx = command_index(p->command);
-            if (idx != -1) {
-                command_map[idx].burst_time = (command_map[idx].burst_time * command_map[idx].count +
-                    p->burst_time) / (command_map[idx].count + 1);
-                command_map[idx].count++;
+            while (a < mid) to[k++] = from[a++];
+            while (b < hi) to[k++] = from[b++];
+        }
+        Process *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != processes) memcpy(processes, from, n * sizeof(Process));
+    free(tmp);
+}
+
+// Function to load a trace with one "command,arrival_ms,burst_ms" line per job
+// The command may itself contain commas, the last two fields are the times. Arrival times
+// go to start_time as in a real run, burst times to burst_time. Jobs are returned in
+// arrival order, stable for equal arrivals. Returns NULL on failure.
+Process *load_online_trace(const char *path, int *n) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror("Error opening trace"); // Print error if file opening fails
+        return NULL;
+    }
+
+    Process *processes = NULL;
+    int capacity = 0;
+    *n = 0;
+    char *line = NULL;
+    size_t line_size = 0;
+    while (getline(&line, &line_size, fp) != -1) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        char *burst = strrchr(line, ',');
+        if (burst == NULL) continue;
+        *burst++ = '\0';
+        char *arrival = strrchr(line, ',');
+        if (arrival == NULL) continue;
+        *arrival++ = '\0';
+
+        if (*n == capacity) {
+            capacity = capacity ? 2 * capacity : MAX_PROCESSES;
+            processes = realloc(processes, capacity * sizeof(Process));
+            if (processes == NULL) {
+                perror("malloc failed"); // Print error if memory allocation fails
+                exit(1);
             }
+        }
+        Process *p = &processes[(*n)++];
+        memset(p, 0, sizeof(Process));
+        p->command = strdup(line);
+        p->start_time = strtoull(arrival, NULL, 10) * NS_PER_MS;
+        p->burst_time = strtoull(burst, NULL, 10) * NS_PER_MS;
+    }
+    free(line);
+    fclose(fp);
+    sort_by_arrival(processes, *n); // The simulations admit jobs in array order
+    return processes;
+}
 
-            // Write process information to the CSV file
-            fprintf(fp, "%s,%s,%s,%lu,%lu,%lu,%lu\n", 
-                    p->command, 
-                    p->error ? "No" : "Yes", 
-                    p->error ? "Yes" : "No", 
-                    p->burst_time, 
-                    p->turnaround_time, 
-                    p->waiting_time, 
-                    p->response_time);
-            fflush(fp);  // Ensure file is flushed after each write
+// Function to simulate Shortest Job First (SJF) scheduling of a trace
+void SimulateShortestJobFirst(const char *trace_path, const char *csv_path) {
+    int n;
+    Process *processes = load_online_trace(trace_path, &n);
+    if (processes == NULL) return;
+    reset_command_map();
+    metrics_reset();
+    if (csv_path == NULL) csv_path = "result_online_sim_SJF.csv";
+    ResultWriter *results = open_results(csv_path);
+
+    uint64_t current_time = 0; // Virtual clock
+    int arrived = 0;           // Processes already admitted
+    int completed = 0;
+    while (completed < n) {
+        while (arrived < n && processes[arrived].start_time <= current_time) {
+            admit_process(processes, arrived++);
+        }
+        int i = pending_pop(processes);
+        if (i == -1) {
+            current_time = processes[arrived].start_time; // Idle until the next arrival
+            continue;
         }
 
-        usleep(100000);  // Sleep for 100 milliseconds before checking again
+        Process *p = &processes[i];
+        uint64_t start_time = current_time;
+        current_time += p->burst_time; // Runs to completion
+        p->turnaround_time = current_time - p->start_time; // Calculate turnaround time
+        p->waiting_time = start_time - p->start_time; // Calculate waiting time
+        p->response_time = start_time - p->start_time; // Response time is same as waiting time
+        p->completed = 1;
+        completed++;
+
+        complete_process(p);
+        write_result_row(results, p);
+    }
+
+    close_results(results, csv_path);
+    for (int i = 0; i < n; i++) free(processes[i].command);
+    free(processes);
+}
+
+// Min-heap of runnable processes keyed on their estimated remaining time, used by SRTF
+typedef struct {
+    int *items;       // Process indices
+    uint64_t *keys;   // Estimated remaining time of each process, indexed like processes
+    int size;
+} RemainingHeap;
+
+// Function to check whether process a should run before process b
+bool remaining_before(RemainingHeap *h, int a, int b) {
+    return h->keys[a] != h->keys[b] ? h->keys[a] < h->keys[b] : a < b;
+}
+
+// Function to add a process with its estimated remaining time
+void remaining_push(RemainingHeap *h, int i, uint64_t key) {
+    h->keys[i] = key;
+    int pos = h->size++;
+    while (pos > 0 && remaining_before(h, i, h->items[(pos - 1) / 2])) {
+        h->items[pos] = h->items[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    h->items[pos] = i;
+}
+
+// Function to remove the process with the least estimated remaining time, -1 if empty
+int remaining_pop(RemainingHeap *h) {
+    if (h->size == 0) return -1;
+    int top = h->items[0];
+    int last = h->items[--h->size];
+    int pos = 0;
+    while (1) {
+        int child = 2 * pos + 1;
+        if (child >= h->size) break;
+        if (child + 1 < h->size && remaining_before(h, h->items[child + 1], h->items[child])) child++;
+        if (!remaining_before(h, h->items[child], last)) break;
+        h->items[pos] = h->items[child];
+        pos = child;
     }
-    fclose(fp); // Close the file
+    if (h->size > 0) h->items[pos] = last;
+    return top;
 }
 
+// Function to simulate Shortest Remaining Time First (SRTF) scheduling of a trace
+// The remaining time of a process is estimated as its command's predicted burst minus
+// what it has already run, taken when it enters the heap. The running process is
+// preempted whenever an arrival is estimated to finish sooner.
+void SimulateShortestRemainingTimeFirst(const char *trace_path, const char *csv_path) {
+    int n;
+    Process *processes = load_online_trace(trace_path, &n);
+    if (processes == NULL) return;
+    reset_command_map();
+    metrics_reset();
+    if (csv_path == NULL) csv_path = "result_online_sim_SRTF.csv";
+    ResultWriter *results = open_results(csv_path);
+
+    RemainingHeap heap;
+    heap.items = malloc(n * sizeof(int));
+    heap.keys = malloc(n * sizeof(uint64_t));
+    heap.size = 0;
+    uint64_t *executed = calloc(n, sizeof(uint64_t));   // Time each process has run
+    uint64_t *first_run = malloc(n * sizeof(uint64_t)); // When each process first ran
+    if (heap.items == NULL || heap.keys == NULL || executed == NULL || first_run == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
 
+    uint64_t current_time = 0; // Virtual clock
+    int arrived = 0;           // Processes already admitted
+    int completed = 0;
+    while (completed < n) {
+        while (arrived < n && processes[arrived].start_time <= current_time) {
+            Process *p = &processes[arrived];
+            p->command_hash = hash_command(p->command);
+            p->command_id = command_index(p->command, p->command_hash);
+            if (p->command_id == -1) {
+                p->command_id = append_command(p->command, p->command_hash);
+            }
+            remaining_push(&heap, arrived, command_map[p->command_id].burst_time);
+            arrived++;
+        }
+        int i = remaining_pop(&heap);
+        if (i == -1) {
+            current_time = processes[arrived].start_time; // Idle until the next arrival
+            continue;
+        }
+
+        Process *p = &processes[i];
+        if (executed[i] == 0) {
+            first_run[i] = current_time;
+        }
+        // Run until the process finishes or the next arrival may preempt it
+        uint64_t left = p->burst_time - executed[i];
+        uint64_t run = left;
+        if (arrived < n && processes[arrived].start_time - current_time < run) {
+            run = processes[arrived].start_time - current_time;
+        }
+        current_time += run;
+        executed[i] += run;
+
+        if (executed[i] < p->burst_time) {
+            uint64_t predicted = command_map[p->command_id].burst_time;
+            remaining_push(&heap, i, predicted > executed[i] ? predicted - executed[i] : 0);
+            continue;
+        }
+
+        p->turnaround_time = current_time - p->start_time; // Calculate turnaround time
+        p->waiting_time = p->turnaround_time - p->burst_time; // Calculate waiting time
+        p->response_time = first_run[i] - p->start_time; // Calculate response time
+        p->completed = 1;
+        completed++;
+        update_command_burst_time(p->command_id, p->burst_time);
+        write_result_row(results, p);
+    }
+
+    close_results(results, csv_path);
+    free(heap.items);
+    free(heap.keys);
+    free(executed);
+    free(first_run);
+    for (int i = 0; i < n; i++) free(processes[i].command);
+    free(processes);
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+// Timing and result output shared by the offline and online schedulers
+// Times are taken from the monotonic clock in nanoseconds. The CSV files still report
+// milliseconds, with three decimals, so short jobs no longer round to zero.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+
+#define NS_PER_MS ((uint64_t)1000000) // Nanoseconds in a millisecond
+#define RESULT_BUFFER_SIZE 65536    // Bytes of result rows buffered before each write
+#define HISTOGRAM_SUB_BITS 5        // 32 sub-buckets per power of two, about 3% precision
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+// Function to get the current time of the monotonic clock in nanoseconds
+uint64_t get_current_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts); // Never jumps when the wall clock is changed
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Buffered writer for result files
+// Rows are formatted straight into a buffer that is written out only when it fills up
+// or the file is closed, instead of one stdio call per field and a flush per row.
+typedef struct {
+    int fd;                         // Result file
+    size_t used;                    // Bytes of buf not written yet
+    char buf[RESULT_BUFFER_SIZE];
+} ResultWriter;
+
+// Function to create or truncate a result file
+void result_writer_open(ResultWriter* w, const char* path) {
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (w->fd == -1) {
+        perror("Error opening file"); // Print error if file opening fails
+        exit(1);
+    }
+    w->used = 0;
+}
+
+// Function to write out everything buffered so far
+void result_writer_flush(ResultWriter* w) {
+    size_t done = 0;
+    while (done < w->used) {
+        ssize_t n = write(w->fd, w->buf + done, w->used - done);
+        if (n <= 0) {
+            perror("Error writing results"); // Print error if the file cannot be written
+            exit(1);
+        }
+        done += n;
+    }
+    w->used = 0;
+}
+
+// Function to flush and close a result file
+void result_writer_close(ResultWriter* w) {
+    result_writer_flush(w);
+    close(w->fd);
+    w->fd = -1;
+}
+
+// Function to append raw bytes to a result file
+void result_write_bytes(ResultWriter* w, const char* data, size_t len) {
+    while (len > 0) {
+        if (w->used == sizeof(w->buf)) result_writer_flush(w);
+        size_t n = sizeof(w->buf) - w->used;
+        if (n > len) n = len;
+        memcpy(w->buf + w->used, data, n);
+        w->used += n;
+        data += n;
+        len -= n;
+    }
+}
+
+// Function to append a string to a result file
+void result_write_str(ResultWriter* w, const char* s) {
+    result_write_bytes(w, s, strlen(s));
+}
+
+// Function to append a single character to a result file
+void result_write_char(ResultWriter* w, char c) {
+    if (w->used == sizeof(w->buf)) result_writer_flush(w);
+    w->buf[w->used++] = c;
+}
+
+// Function to append an unsigned integer in decimal
+void result_write_u64(ResultWriter* w, uint64_t value) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (n > 0) result_write_char(w, digits[--n]);
+}
+
+// Function to append a signed integer in decimal
+void result_write_int(ResultWriter* w, int value) {
+    if (value < 0) {
+        result_write_char(w, '-');
+        result_write_u64(w, -(int64_t)value);
+    } else {
+        result_write_u64(w, value);
+    }
+}
+
+// Function to append value / 1000 with exactly three decimals, without floating point
+void result_write_milli(ResultWriter* w, uint64_t value) {
+    result_write_u64(w, value / 1000);
+    result_write_char(w, '.');
+    result_write_char(w, '0' + value / 100 % 10);
+    result_write_char(w, '0' + value / 10 % 10);
+    result_write_char(w, '0' + value % 10);
+}
+
+// Function to append a duration in nanoseconds as milliseconds with three decimals
+void result_write_ms(ResultWriter* w, uint64_t ns) {
+    result_write_milli(w, ns / 1000); // Microsecond resolution
+}
+
+// HDR-style latency histogram
+// Values below 2^HISTOGRAM_SUB_BITS have a bucket each; above that every power of two
+// is split into HISTOGRAM_SUB_BUCKETS equal buckets, so the relative error is bounded
+// at any magnitude and recording costs a count of leading zeros.
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;   // Number of values recorded
+    uint64_t min;     // Smallest value recorded
+    uint64_t max;     // Largest value recorded
+} LatencyHistogram;
+
+// Function to empty a histogram
+void histogram_reset(LatencyHistogram* h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+// Function to find the bucket of a value
+int histogram_bucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) return (int)value;
+    int exponent = 63 - __builtin_clzll(value); // Position of the highest set bit
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) - HISTOGRAM_SUB_BUCKETS);
+}
+
+// Function to get the smallest value that falls into a bucket
+uint64_t histogram_bucket_low(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    return (uint64_t)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+// Function to add one value to a histogram
+void histogram_record(LatencyHistogram* h, uint64_t value) {
+    h->counts[histogram_bucket(value)]++;
+    h->total++;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+// Function to get the value below which a fraction per_mille / 1000 of the recorded values fall
+// Returns the upper end of the bucket holding that rank, clamped to the largest value seen.
+uint64_t histogram_percentile(const LatencyHistogram* h, uint64_t per_mille) {
+    if (h->total == 0) return 0;
+    uint64_t rank = (h->total * per_mille + 999) / 1000; // 1-based rank of the percentile
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= rank) {
+            uint64_t high = b + 1 < HISTOGRAM_BUCKETS ? histogram_bucket_low(b + 1) - 1 : UINT64_MAX;
+            return high < h->max ? high : h->max;
+        }
+    }
+    return h->max;
+}
+
+// Histograms kept for one scheduler run
+typedef struct {
+    LatencyHistogram turnaround;      // Arrival to completion
+    LatencyHistogram waiting;         // Time runnable but not running
+    LatencyHistogram response;        // Arrival to first run
+    LatencyHistogram context_switch;  // Previous process switched out (SIGSTOP or exit) to SIGCONT
+    LatencyHistogram spawn;           // fork to successful exec of a new process
+} SchedulerMetrics;
+
+SchedulerMetrics scheduler_metrics; // Metrics of the run in progress
+
+// Function to start collecting the metrics of a new run
+void metrics_reset() {
+    histogram_reset(&scheduler_metrics.turnaround);
+    histogram_reset(&scheduler_metrics.waiting);
+    histogram_reset(&scheduler_metrics.response);
+    histogram_reset(&scheduler_metrics.context_switch);
+    histogram_reset(&scheduler_metrics.spawn);
+}
+
+// Function to record the time metrics of a finished process
+void metrics_record_process(uint64_t turnaround, uint64_t waiting, uint64_t response) {
+    histogram_record(&scheduler_metrics.turnaround, turnaround);
+    histogram_record(&scheduler_metrics.waiting, waiting);
+    histogram_record(&scheduler_metrics.response, response);
+}
+
+// Function to append one row of a histogram file
+void histogram_write_row(ResultWriter* w, const char* metric, const char* statistic, uint64_t value, uint64_t count) {
+    result_write_str(w, metric);
+    result_write_char(w, ',');
+    result_write_str(w, statistic);
+    result_write_char(w, ',');
+    result_write_ms(w, value);
+    result_write_char(w, ',');
+    result_write_u64(w, count);
+    result_write_char(w, '\n');
+}
+
+// Function to append the summary and non-empty buckets of one histogram
+void histogram_write(ResultWriter* w, const char* metric, const LatencyHistogram* h) {
+    static const uint64_t percentiles[] = {500, 900, 990, 999};
+    static const char* const percentile_names[] = {"p50", "p90", "p99", "p99.9"};
+
+    // Summary rows carry the number of values recorded, empty histograms report zeros
+    histogram_write_row(w, metric, "min", h->total ? h->min : 0, h->total);
+    for (int k = 0; k < 4; k++) {
+        histogram_write_row(w, metric, percentile_names[k], histogram_percentile(h, percentiles[k]), h->total);
+    }
+    histogram_write_row(w, metric, "max", h->max, h->total);
+
+    // Distribution, one row per non-empty bucket with the lower bound of its values
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        if (h->counts[b] == 0) continue;
+        histogram_write_row(w, metric, "bucket", histogram_bucket_low(b), h->counts[b]);
+    }
+}
+
+// Function to write the histograms of a run next to its result file
+// result.csv gets result_hist.csv, with rows of metric, statistic (min, pNN, max or
+// bucket), value in milliseconds and the number of values recorded, or in the bucket.
+void metrics_write(const char* result_path) {
+    char path[4096];
+    size_t len = strlen(result_path);
+    if (len >= 4 && strcmp(result_path + len - 4, ".csv") == 0) len -= 4;
+    snprintf(path, sizeof(path), "%.*s_hist.csv", (int)len, result_path);
+
+    ResultWriter* w = malloc(sizeof(ResultWriter));
+    if (w == NULL) {
+        perror("malloc failed"); // Print error if memory allocation fails
+        exit(1);
+    }
+    result_writer_open(w, path);
+    result_write_str(w, "Metric,Statistic,Value,Count\n");
+    histogram_write(w, "Turnaround Time", &scheduler_metrics.turnaround);
+    histogram_write(w, "Waiting Time", &scheduler_metrics.waiting);
+    histogram_write(w, "Response Time", &scheduler_metrics.response);
+    histogram_write(w, "Context Switch", &scheduler_metrics.context_switch);
+    histogram_write(w, "Fork Exec", &scheduler_metrics.spawn);
+    result_writer_close(w);
+    free(w);
+}
@@ -1,114 +1,184 @@
 #include <iostream>
-#include <unordered_map>
+#include <string>
+#include <vector>
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
+// Start of a binary trace, see TraceReader
+static const char BINARY_TRACE_MAGIC[8] = {'T', 'L', 'B', 'T', 'R', 'A', 'C', 'E'};
+
 // Node class representing each element in a the MyDS
+// Nodes live in the pool of their MyDS and are linked by index into that pool, so a
+// node is 8 bytes of links (two int indices) plus its data, and neighbours sit in the same array.
 template<typename T>
 class Node {
 public:
     T data;  // Holds the value of the node
-    Node* next;  // Pointer to the next node
-    Node* prev;  // Pointer to the previous node
+    int next;  // Index of the next node, or -1
+    int prev;  // Index of the previous node, or -1
 
-    // Constructor to initialize node with data and null pointers
-    Node(T value) : data(value), next(nullptr), prev(nullptr) {}
+    // Constructor to initialize node with data and no neighbours
+    Node(T value = T()) : data(value), next(-1), prev(-1) {}
 };
 
 // MyDS class acts as a data structure that can work as a queue, stack, or doubly linked list
+// Nodes come from a contiguous pool with a free list, so once the pool is large enough
+// pushes and pops never allocate. The pool starts at the capacity given to the
+// constructor and doubles when it runs out; Node pointers handed out stay valid until
+// the pool grows, which never happens while the size stays within that capacity.
 template<typename T>
 class MyDS {
 private:
-    Node<T>* head;  // Points to the front of the structure
-    Node<T>* tail;  // Points to the back of the structure
+    Node<T>* pool;  // Every node, in use or free
+    int capacity;  // Number of nodes in the pool
+    int freeList;  // First unused node, linked through next, or -1
+    int head;  // Index of the front of the structure, or -1
+    int tail;  // Index of the back of the structure, or -1
     int size;  // Keeps track of the number of elements
 
+    // Function to take a node from the free list, growing the pool if it is empty
+    int allocateNode(T value) {
+        if (freeList == -1) {
+            grow(capacity > 0 ? 2 * capacity : 16);
+        }
+        int index = freeList;
+        freeList = pool[index].next;
+        pool[index].data = value;
+        pool[index].next = pool[index].prev = -1;
+        return index;
+    }
+
+    // Function to put a node back on the free list
+    void releaseNode(int index) {
+        pool[index].next = freeList;
+        freeList = index;
+    }
+
+    // Function to enlarge the pool, keeping the indices of every node
+    void grow(int newCapacity) {
+        Node<T>* newPool = new Node<T>[newCapacity];
+        for (int i = 0; i < capacity; i++) {
+            newPool[i] = pool[i];
+        }
+        for (int i = newCapacity - 1; i >= capacity; i--) {  // New nodes join the free list
+            newPool[i].next = freeList;
+            freeList = i;
+        }
+        delete[] pool;
+        pool = newPool;
+        capacity = newCapacity;
+    }
+
+    // Function to unlink a node from the list without freeing it
+    void unlink(int index) {
+        Node<T>& node = pool[index];
+        if (node.prev != -1) pool[node.prev].next = node.next;  // Update previous node's next
+        else head = node.next;  // If node is head, move head to next node
+        if (node.next != -1) pool[node.next].prev = node.prev;  // Update next node's previous
+        else tail = node.prev;  // If node is tail, move tail to previous node
+    }
+
+    // Function to link an unlinked node in at the front
+    void linkFront(int index) {
+        pool[index].prev = -1;
+        pool[index].next = head;  // Node points to the current head
+        if (head != -1) pool[head].prev = index;  // The old head's previous points to the node
+        else tail = index;  // If the list was empty, the node is also the tail
+        head = index;  // Update head to the node
+    }
+
 public:
-    // Constructor initializes an empty list
-    MyDS() : head(nullptr), tail(nullptr), size(0) {}
+    // Constructor initializes an empty list with room for capacity elements
+    MyDS(int capacity = 0) : pool(nullptr), capacity(0), freeList(-1), head(-1), tail(-1), size(0) {
+        if (capacity > 0) grow(capacity);
+    }
 
-    // Destructor cleans up all nodes to avoid memory leaks
+    // Destructor releases the pool and every node in it
     ~MyDS() {
-        while (!isEmpty()) {
-            popFront();  // Keep removing from the front until the list is empty
-        }
+        delete[] pool;
     }
 
+    // Copying would share the pool
+    MyDS(const MyDS&) = delete;
+    MyDS& operator=(const MyDS&) = delete;
+
     // Function to push a value to the front of the list (used in LRU and Stack)
-    void pushFront(T value) {
-        Node<T>* newNode = new Node<T>(value);  // Create a new node with the value
-        if (isEmpty()) {  // If the list is empty, both head and tail point to the new node
-            head = tail = newNode;
-        } else {
-            newNode->next = head;  // New node points to the current head
-            head->prev = newNode;  // The old head's previous points to the new node
-            head = newNode;  // Update head to the new node
-        }
+    Node<T>* pushFront(T value) {
+        int index = allocateNode(value);  // Take a node for the value
+        linkFront(index);
         size++;  // Increment the size of the list
+        return &pool[index];
     }
 
     // Function to push a value to the back of the list (used in FIFO and Optimal)
-    void pushBack(T value) {
-        Node<T>* newNode = new Node<T>(value);  // Create a new node with the value
-        if (isEmpty()) {  // If the list is empty, both head and tail point to the new node
-            head = tail = newNode;
-        } else {
-            newNode->prev = tail;  // New node's previous points to the current tail
-            tail->next = newNode;  // The current tail's next points to the new node
-            tail = newNode;  // Update tail to the new node
-        }
+    Node<T>* pushBack(T value) {
+        int index = allocateNode(value);  // Take a node for the value
+        pool[index].prev = tail;  // New node's previous points to the current tail
+        if (tail != -1) pool[tail].next = index;  // The current tail's next points to the new node
+        else head = index;  // If the list was empty, the node is also the head
+        tail = index;  // Update tail to the new node
         size++;  // Increment the size of the list
+        return &pool[index];
     }
 
     // Function to pop the front element from the list (used in FIFO, LRU)
     void popFront() {
         if (isEmpty()) return;  // If the list is empty, do nothing
-        Node<T>* temp = head;  // Temporarily store the current head
-        head = head->next;  // Move head to the next node
-        if (head) head->prev = nullptr;  // If there's a new head, set its previous to null
-        else tail = nullptr;  // If no nodes remain, set tail to null
-        delete temp;  // Delete the old head
+        int index = head;
+        unlink(index);
+        releaseNode(index);  // Return the old head to the pool
         size--;  // Decrease the size of the list
     }
 
     // Function to pop the back element from the list (used in LIFO and LRU)
     void popBack() {
         if (isEmpty()) return;  // If the list is empty, do nothing
-        Node<T>* temp = tail;  // Temporarily store the current tail
-        tail = tail->prev;  // Move tail to the previous node
-        if (tail) tail->next = nullptr;  // If there's a new tail, set its next to null
-        else head = nullptr;  // If no nodes remain, set head to null
-        delete temp;  // Delete the old tail
+        int index = tail;
+        unlink(index);
+        releaseNode(index);  // Return the old tail to the pool
         size--;  // Decrease the size of the list
     }
 
-    // Function to remove a specific node (used in LRU)
+    // Function to remove a specific node (used in Optimal)
     void removeNode(Node<T>* node) {
         if (!node) return;  // If the node is null, do nothing
-        if (node->prev) node->prev->next = node->next;  // Update previous node's next
-        else head = node->next;  // If node is head, move head to next node
-        if (node->next) node->next->prev = node->prev;  // Update next node's previous
-        else tail = node->prev;  // If node is tail, move tail to previous node
-        delete node;  // Delete the node
+        int index = node - pool;
+        unlink(index);
+        releaseNode(index);  // Return the node to the pool
         size--;  // Decrease the size of the list
     }
 
+    // Function to move a node to the front without reallocating it (used in LRU)
+    void moveToFront(Node<T>* node) {
+        int index = node - pool;
+        if (index == head) return;  // Already at the front
+        unlink(index);
+        linkFront(index);
+    }
+
     // Function to get the front element (used in FIFO and LRU)
     T getFront() {
         if (isEmpty()) throw std::runtime_error("Structure is empty");  // Throw error if empty
-        return head->data;  // Return the data of the head node
+        return pool[head].data;  // Return the data of the head node
     }
 
     // Function to get the back element (used in LIFO and LRU)
     T getBack() {
         if (isEmpty()) throw std::runtime_error("Structure is empty");  // Throw error if empty
-        return tail->data;  // Return the data of the tail node
+        return pool[tail].data;  // Return the data of the tail node
     }
 
     // Function to check if the structure is empty
     bool isEmpty() {
-        return head == nullptr;  // True if head is null (list is empty)
+        return head == -1;  // True if there is no head (list is empty)
     }
 
     // Function to return the current size of the structure
@@ -119,19 +189,20 @@ public:
     // Iterator class for traversal of MyDS elements
     class Iterator {
     private:
-        Node<T>* current;  // Points to the current node
+        Node<T>* pool;  // Pool of the structure being traversed
+        int current;  // Index of the current node, or -1 at the end
     public:
-        // Constructor to initialize the iterator with a node
-        Iterator(Node<T>* node) : current(node) {}
+        // Constructor to initialize the iterator with a node index
+        Iterator(Node<T>* pool, int index) : pool(pool), current(index) {}
 
         // Dereference operator to access node's data
         T& operator*() {
-            return current->data;
+            return pool[current].data;
         }
 
         // Prefix increment operator to move to the next node
         Iterator& operator++() {
-            if (current) current = current->next;  // Move to the next node
+            if (current != -1) current = pool[current].next;  // Move to the next node
             return *this;
         }
 
@@ -142,30 +213,319 @@ public:
 
         // Get the node currently pointed to by the iterator
         Node<T>* getNode() const {
-            return current;
+            return current != -1 ? &pool[current] : nullptr;
         }
     };
 
     // Function to get an iterator pointing to the head (beginning) of the structure
-    Iterator begin() const { return Iterator(head); }
+    Iterator begin() const { return Iterator(pool, head); }
+
+    // Function to get an iterator pointing to the end of the structure
+    Iterator end() const { return Iterator(pool, -1); }
+};
+
+// PageTable class maps page numbers to values for at most a fixed number of pages
+// Open addressing with linear probing in a power-of-two array at least twice the
+// capacity, so probe runs stay short. Erasing shifts the rest of the run back instead of
+// leaving tombstones, so lookups never slow down as pages come and go. Everything is
+// allocated once by the constructor: the hot path does no heap traffic, and for TLB
+// sizes up to a few thousand the whole table stays in L1.
+template<typename V>
+class PageTable {
+private:
+    static const uint32_t EMPTY = UINT32_MAX;  // Marks a free slot, never a page number
+    uint32_t* keys;  // Page in each slot, or EMPTY
+    V* values;  // Value of the page in each slot
+    uint32_t mask;  // Number of slots minus one
+    int shift;  // Turns a 32-bit hash into a slot index
+
+    // Function to get the slot a page hashes to
+    uint32_t home(uint32_t page) const {
+        return (uint32_t)(page * 2654435769u) >> shift;  // Fibonacci hashing, uses the high bits
+    }
+
+public:
+    // Constructor sizes the table for capacity pages
+    PageTable(int capacity) {
+        int bits = 1;
+        while ((1u << bits) < 2u * (capacity > 0 ? capacity : 1)) bits++;
+        mask = (1u << bits) - 1;
+        shift = 32 - bits;
+        keys = new uint32_t[mask + 1];
+        values = new V[mask + 1];
+        for (uint32_t i = 0; i <= mask; i++) keys[i] = EMPTY;
+    }
+
+    // Destructor releases the slots
+    ~PageTable() {
+        delete[] keys;
+        delete[] values;
+    }
+
+    // Copying would share the slots
+    PageTable(const PageTable&) = delete;
+    PageTable& operator=(const PageTable&) = delete;
+
+    // Function to find the value of a page, nullptr if the page is not in the table
+    V* find(uint32_t page) {
+        for (uint32_t i = home(page);; i = (i + 1) & mask) {
+            if (keys[i] == page) return &values[i];
+            if (keys[i] == EMPTY) return nullptr;
+        }
+    }
+
+    // Function to add a page, or change its value if it is already in the table
+    void insert(uint32_t page, V value) {
+        uint32_t i = home(page);
+        while (keys[i] != EMPTY && keys[i] != page) i = (i + 1) & mask;
+        keys[i] = page;
+        values[i] = value;
+    }
+
+    // Function to remove a page from the table, if it is there
+    void erase(uint32_t page) {
+        uint32_t i = home(page);
+        while (keys[i] != page) {
+            if (keys[i] == EMPTY) return;  // Not in the table
+            i = (i + 1) & mask;
+        }
+        // Move back every later entry of the run that may not sit past the hole
+        for (uint32_t j = (i + 1) & mask; keys[j] != EMPTY; j = (j + 1) & mask) {
+            uint32_t k = home(keys[j]);
+            if (((j - k) & mask) >= ((j - i) & mask)) {  // The hole lies between its home and j
+                keys[i] = keys[j];
+                values[i] = values[j];
+                i = j;
+            }
+        }
+        keys[i] = EMPTY;
+    }
+};
 
-    // Function to get an iterator pointing to the end (nullptr) of the structure
-    Iterator end() const { return Iterator(nullptr); }
+// TraceReader class reads the input of the simulator straight from memory
+// A regular file is mmapped, anything else (a pipe) is read in large blocks, so there is
+// no per-number stream overhead. The input is either the text format, decimal counts and
+// hexadecimal addresses separated by whitespace, or the binary format written by
+// --to-binary: BINARY_TRACE_MAGIC followed by every number as a 32-bit word in native
+// byte order, in the same order as the text format. The format is detected from the
+// first bytes.
+class TraceReader {
+private:
+    const unsigned char* data;  // Whole input
+    size_t length;  // Bytes of input
+    size_t pos;  // Next byte to parse
+    bool mapped;  // Input is an mmapped file rather than buffer
+    bool binary;  // Input is in the binary format
+    vector<unsigned char> buffer;  // Input read from a pipe
+    unsigned char hexDigit[256];  // Value of each hexadecimal digit, 0xFF for other characters
+
+    // Function to skip whitespace before a text number
+    void skipSpace() {
+        while (pos < length && data[pos] <= ' ') pos++;
+    }
+
+    // Function to read the next 32-bit word of a binary trace
+    uint32_t readWord() {
+        if (pos + sizeof(uint32_t) > length) throw std::runtime_error("Binary trace is truncated");
+        uint32_t word;
+        memcpy(&word, data + pos, sizeof(word));
+        pos += sizeof(word);
+        return word;
+    }
+
+public:
+    // Constructor maps or reads everything readable from a file descriptor
+    TraceReader(int fd) : data(nullptr), length(0), pos(0), mapped(false), binary(false) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, st.st_size, MADV_SEQUENTIAL);  // Read once, front to back
+                data = (const unsigned char*)map;
+                length = st.st_size;
+                mapped = true;
+            }
+        }
+        if (!mapped) {
+            size_t used = 0;
+            buffer.resize(1 << 20);
+            while (true) {
+                if (used == buffer.size()) buffer.resize(2 * buffer.size());
+                ssize_t n = read(fd, buffer.data() + used, buffer.size() - used);
+                if (n < 0) throw std::runtime_error("Error reading input");
+                if (n == 0) break;
+                used += n;
+            }
+            data = buffer.data();
+            length = used;
+        }
+
+        memset(hexDigit, 0xFF, sizeof(hexDigit));
+        for (int c = '0'; c <= '9'; c++) hexDigit[c] = c - '0';
+        for (int c = 'a'; c <= 'f'; c++) hexDigit[c] = c - 'a' + 10;
+        for (int c = 'A'; c <= 'F'; c++) hexDigit[c] = c - 'A' + 10;
+
+        if (length >= sizeof(BINARY_TRACE_MAGIC) && memcmp(data, BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC)) == 0) {
+            binary = true;
+            pos = sizeof(BINARY_TRACE_MAGIC);
+        }
+    }
+
+    // Destructor unmaps the input file
+    ~TraceReader() {
+        if (mapped) munmap((void*)data, length);
+    }
+
+    // Copying would unmap the input twice
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    // Function to read a count (T, S, P, K or N)
+    uint32_t readNumber() {
+        if (binary) return readWord();
+        skipSpace();
+        uint32_t value = 0;
+        while (pos < length && (unsigned)(data[pos] - '0') < 10) {
+            value = value * 10 + (data[pos++] - '0');
+        }
+        return value;
+    }
+
+    // Function to read an address, with or without a 0x prefix in the text format
+    uint32_t readAddress() {
+        if (binary) return readWord();
+        skipSpace();
+        if (pos + 1 < length && data[pos] == '0' && (data[pos + 1] | 0x20) == 'x') pos += 2;
+        uint32_t value = 0;
+        unsigned digit;
+        while (pos < length && (digit = hexDigit[data[pos]]) != 0xFF) {
+            value = value << 4 | digit;  // Table lookup, no branches on the character class
+            pos++;
+        }
+        return value;
+    }
+};
+
+// Page sizes of the hierarchy model
+enum PageSizeClass {
+    PAGE_BASE = 0,  // Page size P of the test case, 4K on x86-64
+    PAGE_2M = 1,
+    PAGE_1G = 2
+};
+
+// Page table levels walked on a TLB miss for each page size (x86-64 four-level paging)
+static const int WALK_LEVELS[3] = {4, 3, 2};
+
+// Configuration of one TLB level
+struct TLBLevelConfig {
+    int entries;  // Total entries
+    int ways;  // Entries per set, entries for a fully associative level
+    char policy;  // Replacement within a set: 'f' FIFO, 's' LIFO (stack) or 'l' LRU
+    int hitCycles;  // Cycles a hit at this level costs over an L1 hit
+};
+
+// Configuration of a TLB hierarchy and the page sizes of the address space
+struct HierarchyConfig {
+    vector<TLBLevelConfig> levels;  // L1 first
+    vector<pair<uint32_t, uint32_t>> huge2M;  // Address ranges [first, last] backed by 2M pages
+    vector<pair<uint32_t, uint32_t>> huge1G;  // Address ranges [first, last] backed by 1G pages
+    int walkLevelCycles;  // Cycles per page table level walked
+};
+
+// SetAssociativeTLB class models one level of a TLB
+// Tags are packed set by set in one array, each set ordered newest (FIFO, LIFO) or most
+// recently used (LRU) first, so a lookup scans a few adjacent words and a set holds the
+// same order the MyDS lists of the fully associative simulations keep: a miss pushes at
+// the front and evicts from the back (FIFO, LRU) or replaces the front (LIFO), and an
+// LRU hit moves its tag to the front. A tag encodes the page size and page number, 0
+// marks an empty way.
+class SetAssociativeTLB {
+private:
+    vector<uint64_t> tags;  // ways tags per set
+    int ways;  // Entries per set
+    uint32_t sets;  // Number of sets
+    char policy;  // See TLBLevelConfig
+
+    // Function to get the first tag of the set a page maps to
+    uint64_t* setOf(uint32_t pageNumber) {
+        uint32_t index = (sets & (sets - 1)) == 0 ? pageNumber & (sets - 1) : pageNumber % sets;
+        return &tags[(size_t)index * ways];
+    }
+
+public:
+    // Constructor builds an empty level, throws on an unusable geometry
+    SetAssociativeTLB(const TLBLevelConfig& config) : ways(config.ways), policy(config.policy) {
+        if (config.ways <= 0 || config.entries < config.ways || config.entries % config.ways != 0) {
+            throw std::runtime_error("TLB entries must be a positive multiple of the ways");
+        }
+        sets = config.entries / config.ways;
+        tags.assign(config.entries, 0);
+    }
+
+    // Function to look a page up, updating the LRU order on a hit
+    bool lookup(uint64_t tag, uint32_t pageNumber) {
+        uint64_t* set = setOf(pageNumber);
+        for (int w = 0; w < ways; w++) {
+            if (set[w] == tag) {
+                if (policy == 'l' && w > 0) {
+                    memmove(set + 1, set, w * sizeof(uint64_t));  // Move to the front
+                    set[0] = tag;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Function to add a page that missed, evicting by the policy if its set is full
+    void insert(uint64_t tag, uint32_t pageNumber) {
+        uint64_t* set = setOf(pageNumber);
+        if (policy == 's' && set[ways - 1] != 0) {
+            set[0] = tag;  // Full stack: replace the most recent page
+            return;
+        }
+        memmove(set + 1, set, (ways - 1) * sizeof(uint64_t));  // The back entry falls out
+        set[0] = tag;
+    }
 };
 
 // TLB Simulator class that uses MyDS to simulate various page replacement strategies
 class TLBSimulator {
 private:
     int tlbSize;  // TLB capacity (maximum number of pages it can hold)
+    vector<uint32_t> pageNumbers;  // Page numbers of the current test case, reused across test cases
+    vector<uint32_t> addresses;  // Addresses of the current test case, for the hierarchy model
 
     // Function to extract the page number from an address, given a page size
     uint32_t getPageNumber(uint32_t address, uint32_t pageSize) {
         return address / (pageSize * 1024);  // Divide by page size in KB to get the page number
     }
 
+    // Function to get the shift that turns an address into its page number, -1 if the page
+    // size in KB is not a power of two and getPageNumber has to divide
+    int getPageShift(uint32_t pageSize) {
+        if (pageSize == 0 || (pageSize & (pageSize - 1)) != 0) return -1;
+        return __builtin_ctz(pageSize) + 10;  // log2 of the page size in bytes
+    }
+
+    // Function to read the addresses of a test case as page numbers
+    void readPageNumbers(TraceReader& input, int N, uint32_t P) {
+        pageNumbers.resize(N);
+        int shift = getPageShift(P);
+        if (shift >= 0) {
+            for (int i = 0; i < N; i++) {
+                pageNumbers[i] = input.readAddress() >> shift;  // Calculate page number
+            }
+        } else {
+            for (int i = 0; i < N; i++) {
+                pageNumbers[i] = getPageNumber(input.readAddress(), P);  // Calculate page number
+            }
+        }
+    }
+
     // Function to check if a page is already in the TLB
-    bool isPageInTLB(const unordered_map<uint32_t, bool>& tlbEntries, uint32_t page) {
-        return tlbEntries.find(page) != tlbEntries.end();  // Check if the page is in the TLB
+    bool isPageInTLB(PageTable<bool>& tlbEntries, uint32_t page) {
+        return tlbEntries.find(page) != nullptr;  // Check if the page is in the TLB
     }
 
     // ** FIFO Simulation Functions **
@@ -176,7 +536,7 @@ private:
     }
 
     // Function to handle a TLB miss in FIFO strategy
-    void handleTLBMissFIFO(unordered_map<uint32_t, bool>& tlbEntries,
+    void handleTLBMissFIFO(PageTable<bool>& tlbEntries,
                            MyDS<uint32_t>& fifoQueue,
                            uint32_t page) {
         if (fifoQueue.getSize() == tlbSize) {  // If TLB is full
@@ -185,13 +545,13 @@ private:
             fifoQueue.popFront();  // Remove the front page from the FIFO queue
         }
         fifoQueue.pushBack(page);  // Add the new page to the back of the FIFO queue
-        tlbEntries[page] = true;  // Mark the new page as being in the TLB
+        tlbEntries.insert(page, true);  // Mark the new page as being in the TLB
     }
 
     // Function to simulate FIFO page replacement strategy
     int simulateFIFO(const uint32_t* pageNumbers, int numAccesses) {
-        unordered_map<uint32_t, bool> tlbEntries;  // TLB entries map
-        MyDS<uint32_t> fifoQueue;  // FIFO queue
+        PageTable<bool> tlbEntries(tlbSize);  // TLB entries map
+        MyDS<uint32_t> fifoQueue(tlbSize);  // FIFO queue
         int hits = 0;  // Count of TLB hits
 
         for (int i = 0; i < numAccesses; i++) {
@@ -214,7 +574,7 @@ private:
     }
 
     // Function to handle a TLB miss in LIFO strategy
-    void handleTLBMissLIFO(unordered_map<uint32_t, bool>& tlbEntries,
+    void handleTLBMissLIFO(PageTable<bool>& tlbEntries,
                            MyDS<uint32_t>& lifoStack,
                            uint32_t page) {
         if (lifoStack.getSize() == tlbSize) {  // If TLB is full
@@ -223,13 +583,13 @@ private:
             lifoStack.popBack();  // Remove the back page from the LIFO stack
         }
         lifoStack.pushBack(page);  // Add the new page to the back of the LIFO stack
-        tlbEntries[page] = true;  // Mark the new page as being in the TLB
+        tlbEntries.insert(page, true);  // Mark the new page as being in the TLB
     }
 
     // Function to simulate LIFO page replacement strategy
     int simulateLIFO(const uint32_t* pageNumbers, int numAccesses) {
-        unordered_map<uint32_t, bool> tlbEntries;  // TLB entries map
-        MyDS<uint32_t> lifoStack;  // LIFO stack
+        PageTable<bool> tlbEntries(tlbSize);  // TLB entries map
+        MyDS<uint32_t> lifoStack(tlbSize);  // LIFO stack
         int hits = 0;  // Count of TLB hits
 
         for (int i = 0; i < numAccesses; i++) {
@@ -248,17 +608,14 @@ private:
 
     // Function to handle a TLB hit in LRU strategy
     void handleTLBHitLRU(int& hits,
-                         unordered_map<uint32_t, Node<uint32_t>*>& cache,
-                         MyDS<uint32_t>& lruList,
-                         uint32_t page) {
+                         Node<uint32_t>* node,
+                         MyDS<uint32_t>& lruList) {
         hits++;  // Increment hit count
-        lruList.removeNode(cache[page]);  // Remove the page from its current position in the LRU list
-        lruList.pushFront(page);  // Move the page to the front of the LRU list
-        cache[page] = lruList.begin().getNode();  // Update the cache with the new position
+        lruList.moveToFront(node);  // Move the page to the front of the LRU list, the node stays the same
     }
 
     // Function to handle a TLB miss in LRU strategy
-    void handleTLBMissLRU(unordered_map<uint32_t, Node<uint32_t>*>& cache,
+    void handleTLBMissLRU(PageTable<Node<uint32_t>*>& cache,
                           MyDS<uint32_t>& lruList,
                           uint32_t page) {
         if (lruList.getSize() == tlbSize) {  // If TLB is full
@@ -266,21 +623,21 @@ private:
             lruList.popBack();  // Remove the least recently used page from the list
             cache.erase(lruPage);  // Remove it from the cache
         }
-        lruList.pushFront(page);  // Add the new page to the front of the LRU list
-        cache[page] = lruList.begin().getNode();  // Update the cache with the new page's position
+        cache.insert(page, lruList.pushFront(page));  // Add the new page to the front of the LRU list and track its node
     }
 
     // Function to simulate LRU page replacement strategy
     int simulateLRU(const uint32_t* pageNumbers, int numAccesses) {
-        unordered_map<uint32_t, Node<uint32_t>*> cache;  // Cache map to track page positions
-        MyDS<uint32_t> lruList;  // LRU list
+        PageTable<Node<uint32_t>*> cache(tlbSize);  // Cache map to track page positions
+        MyDS<uint32_t> lruList(tlbSize);  // LRU list
         int hits = 0;  // Count of TLB hits
 
         for (int i = 0; i < numAccesses; i++) {
             uint32_t page = pageNumbers[i];  // Get the current page
 
-            if (cache.find(page) != cache.end()) {
-                handleTLBHitLRU(hits, cache, lruList, page);  // If page is in cache, it's a hit
+            Node<uint32_t>** found = cache.find(page);
+            if (found != nullptr) {
+                handleTLBHitLRU(hits, *found, lruList);  // If page is in cache, it's a hit
             } else {
                 handleTLBMissLRU(cache, lruList, page);  // Otherwise, it's a miss
             }
@@ -288,170 +645,390 @@ private:
         return hits;  // Return the total number of hits
     }
 
+    // Function to find the largest page number of a trace
+    uint32_t findMaxPage(const uint32_t* pageNumbers, int numAccesses) {
+        uint32_t maxPage = 0;
+        for (int i = 0; i < numAccesses; i++) {
+            if (pageNumbers[i] > maxPage) maxPage = pageNumbers[i];
+        }
+        return maxPage;
+    }
+
     // ** Optimal Simulation Functions **
 
-    // Helper function to initialize the next position map for future page accesses
-    void initializeNextPositions(const uint32_t* pageNumbers, int numAccesses, 
-                                unordered_map<uint32_t, int>& nextPosition) {
+    // Helper function to find, for every access, the position of the next access to the same page
+    // Last positions are kept in a flat array indexed by page number; pages that are not
+    // accessed again get numAccesses + 1.
+    void computeNextUse(const uint32_t* pageNumbers, int numAccesses, uint32_t maxPage, int* nextUse) {
+        vector<int> lastSeen(maxPage + 1, numAccesses + 1);  // Next occurrence of each page
         for (int i = numAccesses - 1; i >= 0; --i) {
-            nextPosition[pageNumbers[i]] = i;  // Store the future position of each page
+            uint32_t page = pageNumbers[i];
+            nextUse[i] = lastSeen[page];  // Next use position of the page
+            lastSeen[page] = i;  // Update the last seen position of the page
         }
     }
 
-    // Helper function to handle a TLB hit in the Optimal strategy
-    void handleTLBHitOpt(unordered_map<uint32_t, bool>& tlbEntries, uint32_t page, int& hits) {
-        if (tlbEntries.find(page) != tlbEntries.end()) {  // If page is in TLB, it's a hit
-            hits++;
+    // Helper function to drop the stale entries of the OPT heap and restore the heap order
+    void compactOptHeap(vector<pair<int, uint32_t>>& heap, const vector<int>& residentNext) {
+        size_t kept = 0;
+        for (size_t i = 0; i < heap.size(); i++) {
+            if (residentNext[heap[i].second] == heap[i].first) {
+                heap[kept++] = heap[i];  // Still the next use of a resident page
+            }
         }
+        heap.resize(kept);
+        make_heap(heap.begin(), heap.end());
     }
 
-    // Helper function to find the page to replace in the Optimal strategy
-    uint32_t findPageToReplace(const MyDS<uint32_t>& tlb, 
-                                const unordered_map<uint32_t, int>& nextPosition) {
-        int farthest = -1;  // Track the farthest future use
-        uint32_t replaceValue = 0;  // Page to replace
+    // Function to simulate Optimal page replacement strategy
+    // Belady's algorithm: a miss with a full TLB evicts the page whose next use is farthest
+    // away. Resident pages sit in a max-heap of (next use, page). A hit pushes a new entry
+    // instead of updating the old one, which goes stale and is skipped when it reaches the
+    // top. The heap is compacted whenever it grows past twice the TLB size, so every
+    // access costs O(log K).
+    int simulateOptimal(const uint32_t* pageNumbers, int numAccesses) {
+        if (tlbSize <= 0) return 0;  // A TLB without entries never hits
 
-        for (auto it = tlb.begin(); it != tlb.end(); ++it) {
-            uint32_t currentPage = *it;  // Get the current page in the TLB
-            int futureIdx = nextPosition.at(currentPage);  // Get the future index of the page
+        uint32_t maxPage = findMaxPage(pageNumbers, numAccesses);  // Sizes the flat arrays
+        int* nextUse = new int[numAccesses];  // Dynamically allocated array for next use positions
+        computeNextUse(pageNumbers, numAccesses, maxPage, nextUse);
 
-            // If future index is -1, replace this page (not accessed in future)
-            if (futureIdx == -1) {
-                replaceValue = currentPage;
-                break;
+        vector<int> residentNext(maxPage + 1, -1);  // Next use of each page in the TLB, -1 if not in the TLB
+        vector<pair<int, uint32_t>> heap;  // Max-heap of (next use, page), with stale entries
+        heap.reserve(2 * tlbSize + 1);
+        int resident = 0;  // Number of pages in the TLB
+        int hits = 0;  // Count of TLB hits
+
+        // Simulate TLB accesses
+        for (int i = 0; i < numAccesses; ++i) {
+            uint32_t page = pageNumbers[i];  // Current page being accessed
+            int next_use = nextUse[i];       // Next use position of the current page
+
+            if (residentNext[page] != -1) {
+                hits++;  // TLB hit, only the next use of the page changes
+            } else if (resident < tlbSize) {
+                resident++;  // TLB miss with a free entry
+            } else {
+                // TLB miss with a full TLB: evict the valid entry with the farthest next use
+                while (true) {
+                    pop_heap(heap.begin(), heap.end());
+                    pair<int, uint32_t> top = heap.back();
+                    heap.pop_back();
+                    if (residentNext[top.second] == top.first) {
+                        residentNext[top.second] = -1;  // Replace this page
+                        break;
+                    }
+                }
             }
 
-            // Otherwise, find the page with the farthest future use
-            if (futureIdx > farthest) {
-                farthest = futureIdx;
-                replaceValue = currentPage;
+            residentNext[page] = next_use;
+            heap.push_back(make_pair(next_use, page));
+            push_heap(heap.begin(), heap.end());
+            if ((int)heap.size() > 2 * tlbSize) {
+                compactOptHeap(heap, residentNext);  // Keep the heap O(K)
             }
         }
-        return replaceValue;  // Return the page to replace
+
+        delete[] nextUse;  // Free the allocated memory
+
+        return hits;  // Return the total number of TLB hits
     }
 
-    // Helper function to handle a TLB miss in the Optimal strategy
-    void handleTLBMissOpt(unordered_map<uint32_t, bool>& tlbEntries, 
-                    MyDS<uint32_t>& tlb, 
-                    const unordered_map<uint32_t, int>& nextPosition, 
-                    uint32_t page) {
-        if (tlb.getSize() < tlbSize) {  // If TLB is not full
-            tlb.pushBack(page);  // Add the new page to the TLB
-            tlbEntries[page] = true;  // Mark the page as being in the TLB
-        } else {
-            // Find the page to replace
-            uint32_t replaceValue = findPageToReplace(tlb, nextPosition);
-
-            // Remove the replaced page from TLB and the entries map
-            tlbEntries.erase(replaceValue);
-            for (auto it = tlb.begin(); it != tlb.end(); ++it) {
-                if (*it == replaceValue) {
-                    tlb.removeNode(it.getNode());  // Remove the node representing the replaced page
-                    break;
-                }
+    // ** Miss Ratio Curve Functions **
+
+    // Helper function to count the LRU hits at every TLB size up to maxSize in one pass
+    // The stack distance of an access is the number of distinct pages used since the
+    // previous access to its page, that page included (Mattson et al.); the access hits in
+    // every LRU TLB with at least that many entries. A Fenwick tree over positions marks
+    // the latest access of every page, so each distance is one O(log N) range count.
+    // hits[k] receives the number of hits with k entries.
+    void lruHitCurve(const uint32_t* pageNumbers, int numAccesses, int maxSize, vector<int>& hits) {
+        vector<int> lastAccess(findMaxPage(pageNumbers, numAccesses) + 1, 0);  // 1-based position, 0 if unseen
+        vector<int> tree(numAccesses + 1, 0);  // Fenwick tree of latest-access marks
+        vector<int> distances(maxSize + 2, 0);  // Accesses per stack distance, up to maxSize
+
+        for (int i = 1; i <= numAccesses; i++) {
+            uint32_t page = pageNumbers[i - 1];
+            int previous = lastAccess[page];
+            if (previous != 0) {
+                // Distinct pages since the previous access: marks after it, plus the page itself
+                int distance = 1;
+                for (int j = i - 1; j > 0; j -= j & -j) distance += tree[j];
+                for (int j = previous; j > 0; j -= j & -j) distance -= tree[j];
+                if (distance <= maxSize) distances[distance]++;
+                for (int j = previous; j <= numAccesses; j += j & -j) tree[j]--;  // Clear the old mark
             }
+            for (int j = i; j <= numAccesses; j += j & -j) tree[j]++;  // Mark the latest access
+            lastAccess[page] = i;
+        }
 
-            // Add the new page to the TLB
-            tlb.pushBack(page);
-            tlbEntries[page] = true;
+        hits.assign(maxSize + 1, 0);
+        for (int k = 1; k <= maxSize; k++) {
+            hits[k] = hits[k - 1] + distances[k];  // Hits at distance k or less
         }
     }
 
-    
-    // Function to simulate Optimal page replacement strategy
-    int simulateOptimal(const uint32_t* pageNumbers, int numAccesses) {
-        unordered_map<uint32_t, int> tlbEntries;  // Map from page to its next use position
-        int* nextUse = new int[numAccesses];      // Dynamically allocated array for next use positions
-        unordered_map<uint32_t, int> lastSeen;    // Map to track the next occurrence of each page
+    // Helper function to count the OPT hits at every TLB size up to maxSize in one pass
+    // Mattson's OPT stack: the top k pages are what an optimal TLB with k entries holds.
+    // The accessed page moves to the top and the page it displaces is carried down; at
+    // every level the carried page and the page there compete and the one used again
+    // sooner stays, until the level the accessed page came from. Levels deeper than
+    // maxSize never affect the ones above, so the stack is cut there and each access
+    // costs O(maxSize) at most.
+    void optHitCurve(const uint32_t* pageNumbers, int numAccesses, int maxSize, vector<int>& hits) {
+        uint32_t maxPage = findMaxPage(pageNumbers, numAccesses);
+        int* nextUse = new int[numAccesses];  // Next use position of every access
+        computeNextUse(pageNumbers, numAccesses, maxPage, nextUse);
+        vector<int> pageNext(maxPage + 1, 0);  // Next use of each page, as of its latest access
+        vector<uint32_t> stack;  // OPT stack, top first
+        stack.reserve(maxSize);
+        vector<int> distances(maxSize + 2, 0);  // Accesses per stack distance, up to maxSize
 
-        // Initialize nextUse array by processing the pageNumbers array backwards
-        for (int i = numAccesses - 1; i >= 0; --i) {
+        for (int i = 0; i < numAccesses; i++) {
             uint32_t page = pageNumbers[i];
-            if (lastSeen.find(page) != lastSeen.end()) {
-                nextUse[i] = lastSeen[page];  // Next use position of the page
+            pageNext[page] = nextUse[i];
+            int depth = 0;  // Level the page was found at, 0 if deeper than maxSize
+            if (!stack.empty() && stack[0] == page) {
+                depth = 1;
+            } else if (!stack.empty()) {
+                uint32_t carried = stack[0];
+                stack[0] = page;
+                size_t level = 1;
+                for (; level < stack.size(); level++) {
+                    if (stack[level] == page) {
+                        stack[level] = carried;  // Fills the level the page left
+                        depth = level + 1;
+                        break;
+                    }
+                    if (pageNext[carried] < pageNext[stack[level]]) {
+                        swap(carried, stack[level]);  // The page used sooner stays higher
+                    }
+                }
+                if (depth == 0 && (int)stack.size() < maxSize) {
+                    stack.push_back(carried);  // Room left, nothing is evicted at any size
+                }
             } else {
-                nextUse[i] = numAccesses + 1; // Use a large value if the page is not used again
+                stack.push_back(page);
             }
-            lastSeen[page] = i;  // Update the last seen position of the page
+            if (depth != 0) distances[depth]++;
         }
+        delete[] nextUse;
 
-        int hits = 0;  // Count of TLB hits
+        hits.assign(maxSize + 1, 0);
+        for (int k = 1; k <= maxSize; k++) {
+            hits[k] = hits[k - 1] + distances[k];  // Hits at distance k or less
+        }
+    }
 
-        // Simulate TLB accesses
-        for (int i = 0; i < numAccesses; ++i) {
-            uint32_t page = pageNumbers[i];  // Current page being accessed
-            int next_use = nextUse[i];       // Next use position of the current page
+    // Function to print the miss ratio curves of LRU and OPT for TLB sizes 1 to maxSize
+    // One line per size: the size, the LRU and OPT hit counts and their miss ratios.
+    void printMissRatioCurve(const uint32_t* pageNumbers, int numAccesses, int maxSize) {
+        vector<int> lruHits, optHits;
+        lruHitCurve(pageNumbers, numAccesses, maxSize, lruHits);
+        optHitCurve(pageNumbers, numAccesses, maxSize, optHits);
+        cout << fixed;
+        cout.precision(6);
+        for (int k = 1; k <= maxSize; k++) {
+            double lruMisses = numAccesses > 0 ? 1.0 - (double)lruHits[k] / numAccesses : 0.0;
+            double optMisses = numAccesses > 0 ? 1.0 - (double)optHits[k] / numAccesses : 0.0;
+            cout << k << " " << lruHits[k] << " " << optHits[k] << " "
+                 << lruMisses << " " << optMisses << "\n";
+        }
+        cout << "\n";  // Blank line after each test case
+    }
 
-            if (tlbEntries.find(page) != tlbEntries.end()) {
-                // TLB hit: Update the next use of the page in TLB entries
-                hits++;
-                tlbEntries[page] = next_use;
-            } else {
-                // TLB miss
-                if ((int)tlbEntries.size() < tlbSize) {
-                    // TLB is not full: Add the page to TLB entries
-                    tlbEntries[page] = next_use;
-                } else {
-                    // TLB is full: Find the page with the farthest next use to replace
-                    uint32_t pageToReplace = 0;
-                    int maxNextUse = -1;
-                    for (const auto& entry : tlbEntries) {
-                        if (entry.second > maxNextUse) {
-                            maxNextUse = entry.second;
-                            pageToReplace = entry.first;
-                        }
-                    }
-                    // Replace the page with the farthest next use
-                    tlbEntries.erase(pageToReplace);
-                    tlbEntries[page] = next_use;
+    // ** Hierarchy Simulation Functions **
+
+    // Function to find the page size backing an address
+    PageSizeClass getPageSizeClass(const HierarchyConfig& config, uint32_t address) {
+        for (const auto& range : config.huge1G) {
+            if (address >= range.first && address <= range.second) return PAGE_1G;
+        }
+        for (const auto& range : config.huge2M) {
+            if (address >= range.first && address <= range.second) return PAGE_2M;
+        }
+        return PAGE_BASE;
+    }
+
+    // Function to run a trace through a TLB hierarchy and print one line of results
+    // A lookup goes down the levels until one hits; the page is then filled into every
+    // level above, and into all of them after a page walk on a miss everywhere (neither
+    // inclusive nor exclusive, like common x86 parts). Pages of every size share the
+    // levels. Printed are the hits of each level, the page walks, and the cycles the hits
+    // saved: the walk the page would have needed minus the hit cost of the level.
+    void simulateHierarchy(const HierarchyConfig& config, int N, uint32_t P) {
+        vector<SetAssociativeTLB> levels;
+        levels.reserve(config.levels.size());
+        for (const auto& level : config.levels) levels.emplace_back(level);
+        vector<long long> levelHits(levels.size(), 0);
+        long long walks = 0;
+        long long cyclesSaved = 0;
+        int baseShift = getPageShift(P);
+
+        for (int i = 0; i < N; i++) {
+            uint32_t address = addresses[i];
+            PageSizeClass size = getPageSizeClass(config, address);
+            uint32_t pageNumber = size == PAGE_1G ? address >> 30
+                                : size == PAGE_2M ? address >> 21
+                                : baseShift >= 0 ? address >> baseShift : getPageNumber(address, P);
+            uint64_t tag = ((uint64_t)pageNumber << 2 | size) + 1;  // Never 0
+
+            size_t hitLevel = levels.size();
+            for (size_t l = 0; l < levels.size(); l++) {
+                if (levels[l].lookup(tag, pageNumber)) {
+                    hitLevel = l;
+                    break;
                 }
             }
+            if (hitLevel < levels.size()) {
+                levelHits[hitLevel]++;
+                cyclesSaved += WALK_LEVELS[size] * config.walkLevelCycles - config.levels[hitLevel].hitCycles;
+            } else {
+                walks++;
+            }
+            for (size_t l = 0; l < hitLevel && l < levels.size(); l++) {
+                levels[l].insert(tag, pageNumber);  // Fill the levels that missed
+            }
         }
 
-        delete[] nextUse;  // Free the allocated memory
-
-        return hits;  // Return the total number of TLB hits
+        for (size_t l = 0; l < levels.size(); l++) cout << levelHits[l] << " ";
+        cout << walks << " " << cyclesSaved << "\n";
     }
 
 
 public:
     // Function to process input and run the TLB simulation
-    void processInput() {
-    int T;  // Number of test cases
-    cin >> T;
+    // With curve set, every test case prints the LRU and OPT miss ratio curves for TLB
+    // sizes 1 to K instead of the four hit counts at size K. With a hierarchy, every test
+    // case runs through that TLB hierarchy instead and K is ignored.
+    void processInput(bool curve = false, const HierarchyConfig* hierarchy = nullptr) {
+    TraceReader input(STDIN_FILENO);  // Text or binary trace on standard input
+    int T = input.readNumber();  // Number of test cases
 
     while (T--) {  // Loop through each test case
-        int S, P, K, N;
-        cin >> S >> P >> K >> N;
+        int S = input.readNumber();
+        int P = input.readNumber();
+        int K = input.readNumber();
+        int N = input.readNumber();
+        (void)S;  // Not used by the simulation
         tlbSize = K;  // Set the TLB size for this test case
 
-        uint32_t* pageNumbers = new uint32_t[N];  // Array to store page numbers
-        for (int i = 0; i < N; i++) {
-            uint32_t addr;  // Variable to store the address
-            cin >> hex >> addr;  // Read hexadecimal value directly into uint32_t
-            pageNumbers[i] = getPageNumber(addr, P);  // Calculate page number
+        if (hierarchy != nullptr) {
+            addresses.resize(N);
+            for (int i = 0; i < N; i++) addresses[i] = input.readAddress();
+            simulateHierarchy(*hierarchy, N, P);
+            continue;
         }
-        cin >> dec;  // Reset input stream to decimal mode if needed later
 
-        // Output the results of the different simulation strategies
-        cout << simulateFIFO(pageNumbers, N) << " "
-             << simulateLIFO(pageNumbers, N) << " "
-             << simulateLRU(pageNumbers, N) << " "
-             << simulateOptimal(pageNumbers, N) << endl;
+        readPageNumbers(input, N, P);
 
-        delete[] pageNumbers;  // Clean up dynamically allocated array
+        if (curve) {
+            printMissRatioCurve(pageNumbers.data(), N, K);  // One pass for every size up to K
+            continue;
+        }
+
+        // Output the results of the different simulation strategies
+        cout << simulateFIFO(pageNumbers.data(), N) << " "
+             << simulateLIFO(pageNumbers.data(), N) << " "
+             << simulateLRU(pageNumbers.data(), N) << " "
+             << simulateOptimal(pageNumbers.data(), N) << endl;
     }
 }
 
+    // Function to convert the input on standard input to the binary trace format on standard output
+    void convertToBinary() {
+        TraceReader input(STDIN_FILENO);
+        vector<uint32_t> words;  // Counts and addresses of one test case
+        uint32_t T = input.readNumber();
+        fwrite(BINARY_TRACE_MAGIC, 1, sizeof(BINARY_TRACE_MAGIC), stdout);
+        fwrite(&T, sizeof(T), 1, stdout);
+        while (T--) {
+            words.clear();
+            for (int k = 0; k < 4; k++) words.push_back(input.readNumber());  // S, P, K, N
+            for (uint32_t i = 0; i < words[3]; i++) words.push_back(input.readAddress());
+            if (fwrite(words.data(), sizeof(uint32_t), words.size(), stdout) != words.size()) {
+                throw std::runtime_error("Error writing binary trace");
+            }
+        }
+        fflush(stdout);
+    }
+
 };
 
+// Function to parse the levels of a hierarchy, "entries:ways:policy[:hit cycles]" per
+// level separated by commas, L1 first; policy is fifo, lifo or lru
+vector<TLBLevelConfig> parseLevels(const string& spec) {
+    vector<TLBLevelConfig> levels;
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == string::npos) end = spec.size();
+        string level = spec.substr(start, end - start);
+        char policy[8] = "";
+        TLBLevelConfig config = {0, 0, 'l', levels.empty() ? 0 : 7};  // Lower levels cost about 7 cycles
+        int fields = sscanf(level.c_str(), "%d:%d:%7[a-z]:%d", &config.entries, &config.ways, policy, &config.hitCycles);
+        string name = policy;
+        if (fields < 3 || (name != "fifo" && name != "lifo" && name != "lru")) {
+            throw std::runtime_error("Bad TLB level \"" + level + "\", expected entries:ways:fifo|lifo|lru[:cycles]");
+        }
+        config.policy = name == "fifo" ? 'f' : name == "lifo" ? 's' : 'l';
+        levels.push_back(config);
+        start = end + 1;
+    }
+    return levels;
+}
+
+// Function to parse an address range "first-last" in hexadecimal
+pair<uint32_t, uint32_t> parseRange(const string& spec) {
+    unsigned long first, last;
+    if (sscanf(spec.c_str(), "%lx-%lx", &first, &last) != 2 || first > last) {
+        throw std::runtime_error("Bad address range \"" + spec + "\", expected first-last in hexadecimal");
+    }
+    return make_pair((uint32_t)first, (uint32_t)last);
+}
+
 // Main function
-int main() {
+// Usage: ./a.out [--curve] < input
+//        ./a.out --to-binary < input > trace.bin, then ./a.out < trace.bin to skip parsing
+//        ./a.out --hierarchy[=levels] [--huge2m=first-last]... [--huge1g=first-last]...
+//                [--walk-cycles=n] < input
+// The hierarchy defaults to 64:4:lru,1536:12:lru, a 64-entry 4-way L1 and a 1536-entry
+// 12-way L2, with 25 cycles per page table level walked. Each test case then prints the
+// hits of every level, the page walks and the estimated walk cycles saved.
+int main(int argc, char* argv[]) {
     ios_base::sync_with_stdio(false);  // Disable synchronization with C-style IO for performance
     cin.tie(NULL);  // Untie cin from cout to speed up input processing
 
-    TLBSimulator simulator;  // Create an instance of TLBSimulator
-    simulator.processInput();  // Process the input and run the simulations
+    try {
+        bool curve = false;  // Miss ratio curves instead of hit counts
+        bool toBinary = false;  // Convert the input to a binary trace
+        bool useHierarchy = false;  // Run the input through a TLB hierarchy
+        HierarchyConfig hierarchy;
+        hierarchy.levels = parseLevels("64:4:lru,1536:12:lru");
+        hierarchy.walkLevelCycles = 25;
+        for (int a = 1; a < argc; a++) {
+            string arg = argv[a];
+            string value = arg.find('=') != string::npos ? arg.substr(arg.find('=') + 1) : "";
+            if (arg == "--curve") curve = true;
+            else if (arg == "--to-binary") toBinary = true;
+            else if (arg == "--hierarchy") useHierarchy = true;
+            else if (arg.rfind("--hierarchy=", 0) == 0) useHierarchy = true, hierarchy.levels = parseLevels(value);
+            else if (arg.rfind("--huge2m=", 0) == 0) hierarchy.huge2M.push_back(parseRange(value));
+            else if (arg.rfind("--huge1g=", 0) == 0) hierarchy.huge1G.push_back(parseRange(value));
+            else if (arg.rfind("--walk-cycles=", 0) == 0) hierarchy.walkLevelCycles = stoi(value);
+            else throw std::runtime_error("Unknown option " + arg);
+        }
+
+        TLBSimulator simulator;  // Create an instance of TLBSimulator
+        if (toBinary) {
+            simulator.convertToBinary();  // Write the input out in the binary trace format
+        } else {
+            simulator.processInput(curve, useHierarchy ? &hierarchy : nullptr);  // Process the input and run the simulations
+        }
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+        return 1;
+    }
 
     return 0;
 }
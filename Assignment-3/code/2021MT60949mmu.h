@@ -5,26 +5,171 @@
 #include <unistd.h>     // Provides sbrk and getpagesize functions
 #include <string.h>     // Provides memset function
 #include <stdint.h>     // Provides fixed-width integer types
+#include <pthread.h>    // Provides the mutex of the shared heap and thread-specific data
+#include <sys/syscall.h> // Provides SYS_mremap, called directly so _GNU_SOURCE is not needed
+
+#ifndef MREMAP_MAYMOVE
+#define MREMAP_MAYMOVE 1   // Flag of mremap, from <sys/mman.h> when _GNU_SOURCE is defined
+#endif
 
 // Constants to define memory management rules
 #define ALIGNMENT 16                     // Alignment requirement for memory blocks
 #define MAGIC 1234567                    // Magic number for validating memory blocks during free
+#define RELEASED_MAGIC 7654321           // Magic of a free span that knows which of its pages are released
 #define MMAP_THRESHOLD (8 * 1024)      // Size threshold for mmap vs. heap allocation (8 KB)
-#define HEAP_EXPANSION_SIZE (16 * 1024) // Expansion size for the heap (16 MB)
+#define ARENA_MIN_SIZE (64 * 1024)       // Size of the first heap arena (64 KB)
+#define ARENA_MAX_SIZE (64 * 1024 * 1024) // Arenas double in size up to this (64 MB)
+#define DEFAULT_TRIM_THRESHOLD (128 * 1024) // Free spans from this size on are returned to the OS (128 KB)
+#define TRIM_PAD (2 * MMAP_THRESHOLD)    // Front of a trimmed span first kept resident, room for any heap block (16 KB)
+#define TRIM_PAD_MAX (8 * 1024 * 1024)   // The resident front grows up to this (8 MB)
+#define SMALL_BIN_LIMIT 512              // Sizes up to this get one bin per ALIGNMENT step
+#define NUM_SMALL_BINS (SMALL_BIN_LIMIT / ALIGNMENT) // Exact bins for 16, 32, ..., 512 bytes
+#define NUM_BINS 48                      // Exact bins followed by power-of-two ranges
+#define THREAD_CACHE_BATCH 32            // Blocks moved between a thread cache and the heap at once
+#define THREAD_CACHE_LIMIT 64            // Blocks a thread caches per size before flushing a batch
+#define SLAB_PAGE_SIZE (64 * 1024)       // Slab pages are this size and aligned to it (64 KB)
+#define SLAB_MAX_OBJECT (SLAB_PAGE_SIZE / 8) // Largest object size a slab accepts
+
+#define BLOCK_FREE 1                     // Flag: the block is free
+#define BLOCK_MMAP 2                     // Flag: the block was allocated using its own mmap
+#define BLOCK_PREV_FREE 4                // Flag: the physically previous block is free, prev_size is valid
+#define BLOCK_FENCE 8                    // Flag: last block of an arena, its payload points to the arena
+#define BLOCK_FLAGS (ALIGNMENT - 1)      // Sizes are multiples of ALIGNMENT, the low bits hold the flags
 
-// Structure representing the header of a memory block
+// Structure representing the header of a memory block (16 bytes)
+// The flags live in the low bits of size. Heap blocks use boundary tags: while a block
+// is free its size is also kept in prev_size of the physically next block, which has
+// BLOCK_PREV_FREE set, so both neighbours of a block are found in O(1). The bin links
+// of a free block, and the cache link of a cached block, are kept in its payload.
 typedef struct block_header {
-    size_t size;                         // Size of the block
-    int is_free;                         // Indicates whether the block is free (1) or allocated (0)
-    int is_mmap;                         // Indicates if the block was allocated using mmap (1)
-    struct block_header* next;           // Pointer to the next block in the free list
-    int magic;                           // Magic number for validation
+    size_t size;                         // Size of the block, with the BLOCK_* flags in the low bits
+    uint32_t prev_size;                  // Size of the physically previous block while it is free
+    uint32_t magic;                      // Magic number for validation
 } block_header_t;
 
+// Block field access functions
+// The size word is only written with heap_lock held, but BLOCK_PREV_FREE of an allocated
+// block changes when its neighbour is freed, while the owner reads its size and
+// BLOCK_MMAP without the lock. Relaxed atomic accesses make those reads well defined and
+// compile to plain loads and stores.
+static size_t load_block_word(block_header_t* block) {
+    return __atomic_load_n(&block->size, __ATOMIC_RELAXED);
+}
+
+// Stores the size word of a block
+static void store_block_word(block_header_t* block, size_t word) {
+    __atomic_store_n(&block->size, word, __ATOMIC_RELAXED);
+}
+
+// Returns the size of a block without its flags
+static size_t block_size(block_header_t* block) {
+    return load_block_word(block) & ~(size_t)BLOCK_FLAGS;
+}
+
+// Changes the size of a block, keeping its flags
+static void set_block_size(block_header_t* block, size_t size) {
+    store_block_word(block, size | (load_block_word(block) & BLOCK_FLAGS));
+}
+
+// Tells whether a block has a flag set
+static int block_has(block_header_t* block, size_t flag) {
+    return (load_block_word(block) & flag) != 0;
+}
+
+// Link to the next block in a bin or a thread cache, stored in the first word of the payload
+static block_header_t** next_link(block_header_t* block) {
+    return (block_header_t**)(block + 1);
+}
+
+// Back link of a free block in its bin, stored in the second word of the payload
+static block_header_t** prev_link(block_header_t* block) {
+    return (block_header_t**)(block + 1) + 1;
+}
+
+// Bytes at the front of a free span that may be resident, stored in the third word of the
+// payload when the span has RELEASED_MAGIC: every page after them has been released.
+static size_t* resident_front(block_header_t* block) {
+    return (size_t*)(block + 1) + 2;
+}
+
+// Returns how many bytes at the front of a free block may be resident
+static size_t resident_bytes(block_header_t* block) {
+    return block->magic == RELEASED_MAGIC ? *resident_front(block) : block_size(block);
+}
+
 // Global variables for heap management
-static block_header_t* free_list = NULL; // Head of the free list
-static void* heap_start = NULL;          // Start of the current heap space
-static void* heap_end = NULL;            // End of the current heap space
+// Free blocks are kept in segregated bins: one bin per exact size up to SMALL_BIN_LIMIT,
+// then one bin per power-of-two range. Bins are doubly linked, the back link lives in
+// the payload of the free block, and a bitmap marks the non-empty bins.
+static block_header_t* bins[NUM_BINS];   // Head of the free list of each bin
+static uint64_t nonempty_bins = 0;       // Bit b is set when bins[b] has free blocks
+
+// Structure at the start of every heap arena
+// An arena is one mapping: this header, the blocks, and an allocated fence block at the
+// end whose payload points back to the arena.
+typedef struct arena {
+    struct arena* next;                  // Next arena in the list of all arenas
+    struct arena* prev;                  // Previous arena in the list of all arenas
+    size_t size;                         // Bytes mapped, headers and fence included
+    size_t reserved;                     // Keeps the first block ALIGNMENT-aligned
+} arena_t;
+
+static arena_t* arenas = NULL;           // Every heap arena currently mapped
+static int num_arenas = 0;               // Number of arenas in the list
+static size_t next_arena_size = ARENA_MIN_SIZE;           // Size of the next arena, doubled each time
+static arena_t* spare_arena = NULL;      // Entirely free arena kept mapped for reuse, or NULL
+static int released_arenas = 0;          // Arenas unmapped and not yet replaced by a new one
+static size_t trim_pad = TRIM_PAD;       // Resident front of trimmed spans, see trim_free_block
+static size_t trim_threshold = DEFAULT_TRIM_THRESHOLD;    // See my_set_trim_threshold
+
+static uint64_t free_list_searches = 0;  // Calls of find_free_block
+static uint64_t free_list_steps = 0;     // Free blocks looked at by those calls
+
+// Everything above is shared by all threads and only used with heap_lock held
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Allocation counters of one thread
+// Only the owning thread writes its counters, so counting needs no lock and no shared
+// cache line; my_malloc_stats adds up the counters of every thread. A block freed by
+// another thread is subtracted there, so per-thread byte counts may wrap below zero
+// while the sums stay right.
+typedef struct thread_stats {
+    uint64_t malloc_calls;               // Successful calls of my_malloc (and my_calloc)
+    uint64_t free_calls;                 // Blocks released by my_free
+    uint64_t bytes_requested;            // Sum of the sizes asked for
+    uint64_t bytes_in_use;               // Payload bytes allocated minus payload bytes freed
+    uint64_t mmap_blocks;                // Blocks mapped minus blocks unmapped
+    uint64_t mmap_bytes;                 // Bytes mapped minus bytes unmapped for those blocks
+} thread_stats_t;
+
+// Callback run on sampled allocations, see my_set_sample_hook
+typedef void (*my_malloc_sample_hook_t)(void* ptr, size_t size);
+
+static my_malloc_sample_hook_t sample_hook = NULL; // Set by my_set_sample_hook
+static uint64_t sample_period = 0;                 // Allocations per call of sample_hook
+
+// Per-thread cache of small blocks
+// Blocks up to SMALL_BIN_LIMIT are freed into, and allocated from, a cache of the calling
+// thread without taking heap_lock. Cached blocks still count as allocated for the heap,
+// so they are never merged; a thread moves THREAD_CACHE_BATCH of them to or from the
+// heap under a single lock when a list runs empty or grows past THREAD_CACHE_LIMIT.
+// A block freed by another thread than the one that allocated it simply joins the cache
+// of the freeing thread. The cache is flushed back to the heap when the thread exits.
+typedef struct thread_cache {
+    block_header_t* lists[NUM_SMALL_BINS]; // Cached blocks of each exact size, linked through next_link
+    int counts[NUM_SMALL_BINS];            // Number of blocks in each list
+    int registered;                        // Set once the exit destructor is armed for this thread
+    thread_stats_t stats;                  // Counters of this thread
+    uint64_t sample_countdown;             // Allocations left before the next sample
+    struct thread_cache* next;             // Next registered thread, in thread_caches
+    struct thread_cache* prev;             // Previous registered thread, in thread_caches
+} thread_cache_t;
+
+static thread_cache_t* thread_caches = NULL;  // Caches of the running threads, with heap_lock held
+static thread_stats_t retired_stats;          // Counters of threads that exited, with heap_lock held
+static __thread thread_cache_t thread_cache;  // Cache of the calling thread
+static pthread_key_t thread_cache_key;        // Runs flush_thread_cache at thread exit
+static pthread_once_t thread_cache_once = PTHREAD_ONCE_INIT;
 
 // Alignment functions 
 // Aligns the requested size to the nearest multiple of ALIGNMENT
@@ -39,75 +184,154 @@ static size_t align_to_page(size_t size) {
 }
 
 // Free list management functions
-// Appends a block to the free list, ensuring the list remains linked properly
-static void append_block_to_free_list(block_header_t* block) {
-    block->next = NULL;
-    if (free_list == NULL) {
-        free_list = block;
-    } else {
-        block_header_t* current = free_list;
-        while (current->next != NULL) {
-            current = current->next;
-        }
-        current->next = block;
+// Returns the bin holding free blocks of the given (aligned) size
+static int bin_index(size_t size) {
+    if (size <= SMALL_BIN_LIMIT) {
+        return (int)(size / ALIGNMENT) - 1;  // Exact bins: 16 -> 0, 32 -> 1, ...
     }
+    // Ranges (512, 1K], (1K, 2K], ... follow the exact bins
+    int bin = NUM_SMALL_BINS + (63 - __builtin_clzll(size - 1)) - 9;
+    return bin < NUM_BINS ? bin : NUM_BINS - 1;
 }
 
-// Finds the previous block in the free list (useful for merging operations)
-static block_header_t* find_prev_block(block_header_t* block) {
-    block_header_t* current = free_list;
-    while (current != NULL && current->next != block) {
-        current = current->next;
+// Pushes a free block onto the front of its bin
+static void insert_free_block(block_header_t* block) {
+    int bin = bin_index(block_size(block));
+    *next_link(block) = bins[bin];
+    *prev_link(block) = NULL;
+    if (bins[bin] != NULL) {
+        *prev_link(bins[bin]) = block;
+    }
+    bins[bin] = block;
+    nonempty_bins |= 1ULL << bin;
+}
+
+// Unlinks a free block from its bin
+static void remove_free_block(block_header_t* block) {
+    int bin = bin_index(block_size(block));
+    block_header_t* prev = *prev_link(block);
+    block_header_t* next = *next_link(block);
+    if (prev != NULL) {
+        *next_link(prev) = next;
+    } else {
+        bins[bin] = next;
+    }
+    if (next != NULL) {
+        *prev_link(next) = prev;
+    }
+    if (spare_arena != NULL && block == (block_header_t*)(spare_arena + 1)) {
+        spare_arena = NULL;  // The spare arena is about to be used again
+    }
+    if (bins[bin] == NULL) {
+        nonempty_bins &= ~(1ULL << bin);
     }
-    return current;
 }
 
 // Searches for a free block that can satisfy a memory request of a given size
+// Exact bins hold blocks of one size only, so their head is taken in O(1). In a range bin
+// the best fit is taken; if the first non-empty bin has no fit the next one is tried,
+// and every block of a higher bin fits.
 static block_header_t* find_free_block(size_t size) {
-    block_header_t* current = free_list;
-    while (current != NULL) {
-        if (current->is_free && current->size >= size) {
-            return current;  // Return the first free block that fits the size
+    int bin = bin_index(size);
+    uint64_t candidates = nonempty_bins & (~0ULL << bin); // Bins that may hold a fit
+    free_list_searches++;
+    while (candidates != 0) {
+        int b = __builtin_ctzll(candidates);
+        if (b < NUM_SMALL_BINS) {
+            free_list_steps++;
+            return bins[b];  // Every block in an exact bin has the same size
+        }
+        block_header_t* best = NULL;
+        for (block_header_t* current = bins[b]; current != NULL; current = *next_link(current)) {
+            size_t current_size = block_size(current);
+            free_list_steps++;
+            if (current_size >= size && (best == NULL || current_size < block_size(best))) {
+                best = current;
+                if (current_size == size) break;  // Cannot do better than an exact fit
+            }
         }
-        current = current->next;
+        if (best != NULL) {
+            return best;
+        }
+        candidates &= candidates - 1;  // Nothing fits here, try the next bin
     }
     return NULL;  // No suitable block found
 }
 
+// Returns the block that physically follows a heap block
+// Every arena ends with an allocated fence block, so the result is always a valid header.
+static block_header_t* next_physical_block(block_header_t* block) {
+    return (block_header_t*)((char*)(block + 1) + block_size(block));
+}
+
+// Returns the block that physically precedes a heap block, using its prev_size field
+// Only valid when BLOCK_PREV_FREE is set; the first block of an arena never has it set.
+static block_header_t* prev_physical_block(block_header_t* block) {
+    return (block_header_t*)((char*)block - block->prev_size - sizeof(block_header_t));
+}
+
+// Marks a heap block free and records its size in the next block
+static void mark_block_free(block_header_t* block) {
+    block_header_t* next = next_physical_block(block);
+    store_block_word(block, load_block_word(block) | BLOCK_FREE);
+    next->prev_size = (uint32_t)block_size(block);  // Heap blocks are smaller than an arena
+    store_block_word(next, load_block_word(next) | BLOCK_PREV_FREE);
+}
+
+// Marks a heap block allocated and tells the next block
+static void mark_block_allocated(block_header_t* block) {
+    block_header_t* next = next_physical_block(block);
+    store_block_word(block, load_block_word(block) & ~(size_t)BLOCK_FREE);
+    store_block_word(next, load_block_word(next) & ~(size_t)BLOCK_PREV_FREE);
+}
+
 // Block management functions 
 // Splits a larger block into two smaller blocks if there's extra space after allocation
+// The front part is about to be allocated; the remainder is marked free and put into its bin.
 static block_header_t* split_block(block_header_t* block, size_t size) {
     size_t min_block_size = sizeof(block_header_t) + ALIGNMENT; // Minimum size for a block
-    if (block->size >= size + min_block_size) {
-        // Create a new block from the excess memory
+    if (block_size(block) >= size + min_block_size) {
+        // The released pages of a free span stay released in its remainder
+        size_t shift = size + sizeof(block_header_t);  // From the old payload to the new one
+        size_t resident = resident_bytes(block);         // Read before the new header may cover it
+        int tracked = block->magic == RELEASED_MAGIC && block_size(block) - shift >= 3 * sizeof(size_t);
+
+        // Create a new block from the excess memory, not mmap'd and after an allocated block
         block_header_t* new_block = (block_header_t*)((char*)(block + 1) + size);
-        new_block->size = block->size - size - sizeof(block_header_t);
-        new_block->is_free = 1;   // Mark new block as free
-        new_block->is_mmap = 0;   // Not allocated via mmap
-        new_block->next = block->next; // Link the new block to the next one in the list
+        new_block->size = block_size(block) - size - sizeof(block_header_t);
+        new_block->prev_size = 0;
         new_block->magic = MAGIC; // Set magic number for validation
-        block->size = size;       // Update original block's size
-        block->next = new_block;  // Link to the new block
+        if (block->magic == RELEASED_MAGIC && resident + getpagesize() < shift && trim_pad < TRIM_PAD_MAX) {
+            trim_pad *= 2;  // Released pages are faulted back in, keep more of the next span resident
+        }
+        if (tracked) {
+            new_block->magic = RELEASED_MAGIC;
+            *resident_front(new_block) = resident > shift + 3 * sizeof(size_t) ? resident - shift : 3 * sizeof(size_t);
+        }
+        set_block_size(block, size); // Update original block's size
+        mark_block_free(new_block);
+        insert_free_block(new_block);
     }
     return block;  // Return the (possibly split) block
 }
 
-// Merges the current block with the next block if it's free
+// Merges the current block with the physically next block if it's free
 static void merge_with_next_block(block_header_t* block) {
-    if (block->next != NULL && block->next->is_free) {
-        // Merge with the next block by updating the size and skipping over the next block
-        block->size += sizeof(block_header_t) + block->next->size;
-        block->next = block->next->next;
+    block_header_t* next = next_physical_block(block);
+    if (block_has(next, BLOCK_FREE)) {
+        // Merge with the next block by taking it out of its bin and absorbing its space
+        remove_free_block(next);
+        set_block_size(block, block_size(block) + sizeof(block_header_t) + block_size(next));
     }
 }
 
-// Merges the current block with the previous block if it's free
+// Merges the current block with the physically previous block if it's free
 static void merge_with_prev_block(block_header_t** block) {
-    block_header_t* prev = find_prev_block(*block);
-    if (prev != NULL && prev->is_free) {
-        // Merge with the previous block by updating the size and skipping over the current block
-        prev->size += sizeof(block_header_t) + (*block)->size;
-        prev->next = (*block)->next;
+    if (block_has(*block, BLOCK_PREV_FREE)) {
+        // The previous block absorbs the current one, found through its size kept in prev_size
+        block_header_t* prev = prev_physical_block(*block);
+        remove_free_block(prev);
+        set_block_size(prev, block_size(prev) + sizeof(block_header_t) + block_size(*block));
         *block = prev;  // Update block pointer to point to the merged block
     }
 }
@@ -118,62 +342,157 @@ static void merge_adjacent_free_blocks(block_header_t** block) {
     merge_with_prev_block(block);   // Then, try to merge with the previous block
 }
 
-// Memory allocation functions 
-// Requests a new block of memory from the heap, expanding the heap if necessary
-static block_header_t* request_new_heap_block(size_t size) {
-    // Align total requested size to the page size (including block header)
-    size_t total_size = align_to_page(size + sizeof(block_header_t));
-
-    // If there is no heap space left or the remaining heap space is insufficient, expand the heap
-    if (heap_start == NULL || heap_end - heap_start < total_size) {
-        // Expand the heap by requesting a large chunk of memory using mmap
-        size_t expansion_size = HEAP_EXPANSION_SIZE;
-        void* new_heap = mmap(
-            NULL,
-            expansion_size,
-            PROT_READ | PROT_WRITE,
-            MAP_PRIVATE | MAP_ANONYMOUS,
-            -1,
-            0
-        );
-        if (new_heap == MAP_FAILED) {
-            return NULL;  // mmap failed
-        }
-        heap_start = new_heap;                 // Set heap_start to the beginning of the newly allocated chunk
-        heap_end = heap_start + expansion_size; // Set heap_end to the end of the newly allocated chunk
+// Arena management functions
+// Returns the first block of an arena
+static block_header_t* arena_first_block(arena_t* arena) {
+    return (block_header_t*)(arena + 1);
+}
+
+// Maps a new arena that can hold a block of the given size and links it into the list
+// Arenas grow geometrically, so a heap of n bytes needs O(log n) mappings. The whole
+// arena starts as a single free block, which is returned without being put in a bin.
+static block_header_t* map_new_arena(size_t size) {
+    size_t needed = sizeof(arena_t) + 2 * sizeof(block_header_t) + size + ALIGNMENT;  // Arena, block, fence
+    size_t arena_size = next_arena_size;
+    while (arena_size < needed) {
+        arena_size *= 2;
+    }
+    if (released_arenas > 0) {
+        released_arenas--;     // Replaces an arena given back, the heap has not grown
+    } else if (next_arena_size < ARENA_MAX_SIZE) {
+        next_arena_size *= 2;  // The next arena is twice as large
     }
 
-    // Carve out a block from the newly expanded heap
-    block_header_t* block = heap_start;
-    heap_start = (void*)((char*)heap_start + total_size); // Move heap_start forward by the size of the allocated block
+    arena_t* arena = mmap(
+        NULL,
+        arena_size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if (arena == MAP_FAILED) {
+        return NULL;  // mmap failed
+    }
+    arena->size = arena_size;
+    arena->prev = NULL;
+    arena->next = arenas;
+    if (arenas != NULL) {
+        arenas->prev = arena;
+    }
+    arenas = arena;
+    num_arenas++;
 
-    // Initialize the block's metadata (header)
-    block->size = total_size - sizeof(block_header_t);
-    block->is_free = 0;         // Mark the block as allocated
-    block->is_mmap = 0;         // This block was not directly allocated via mmap
-    block->next = NULL;         // Not yet part of the free list
-    block->magic = MAGIC;       // Set the magic number for validation
+    // The fence stops merging from running past the arena and leads back to it
+    block_header_t* fence = (block_header_t*)((char*)arena + arena_size - sizeof(block_header_t) - ALIGNMENT);
+    fence->size = ALIGNMENT | BLOCK_FENCE;
+    fence->prev_size = 0;
+    fence->magic = 0;
+    *(arena_t**)(fence + 1) = arena;
 
-    // Add the remaining space (if any) to the free list
-    if (heap_end - heap_start > sizeof(block_header_t)) {
-        // There is remaining space after the allocation, so create a new free block
-        block_header_t* remaining_block = (block_header_t*)heap_start;
-        remaining_block->size = heap_end - heap_start - sizeof(block_header_t);
-        remaining_block->is_free = 1;        // Mark it as free
-        remaining_block->is_mmap = 0;        // It is part of the heap, not mmap
-        remaining_block->next = NULL;        // Not linked yet
-        remaining_block->magic = MAGIC;      // Set the magic number
+    block_header_t* block = arena_first_block(arena);
+    block->size = (char*)fence - (char*)(block + 1);  // Allocated, first block of the arena
+    block->prev_size = 0;
+    block->magic = MAGIC;
+    return block;
+}
 
-        // Move heap_start to the end of the remaining space
-        heap_start = heap_end;
+// Releases the whole pages of [low, high) that lie within [start, end) with MADV_DONTNEED
+// low and high are widened to page boundaries; start and end must be on them.
+static void release_pages(char* low, char* high, uintptr_t start, uintptr_t end) {
+    size_t page_size = getpagesize();
+    uintptr_t first = (uintptr_t)low & ~(uintptr_t)(page_size - 1);
+    uintptr_t last = ((uintptr_t)high + page_size - 1) & ~(uintptr_t)(page_size - 1);
+    if (first < start) first = start;
+    if (last > end) last = end;
+    if (last > first) {
+        madvise((void*)first, last - first, MADV_DONTNEED);
+    }
+}
 
-        // Add the remaining block to the free list
-        append_block_to_free_list(remaining_block);
+// Returns a free heap block to the OS if it is large enough to be worth it
+// A block spanning a whole arena unmaps the arena, unless no other arena is entirely
+// free: one empty arena stays mapped as the spare, so a malloc and free at the edge of
+// the heap do not map and unmap an arena every time.
+// Otherwise the pages inside a block of at least trim_threshold bytes are released with
+// MADV_DONTNEED: they stay mapped, but no longer count towards RSS until touched again.
+// The first trim_pad bytes stay resident: blocks are split off the front of a span, so a
+// malloc right after the free reuses those pages without faulting them back in. A split
+// that still has to fault released pages back in doubles trim_pad (up to TRIM_PAD_MAX),
+// like glibc raises its trim threshold, so a program that keeps reusing freed memory
+// soon stops having it released under it.
+// Only the parts of the block that may be resident are released, [block, front_end) and
+// [dirty_start, dirty_end) (see heap_free), and the block then records that only its
+// front is resident. Returns 1 if the block no longer exists.
+static int trim_free_block(block_header_t* block, char* front_end, char* dirty_start, char* dirty_end) {
+    block_header_t* next = next_physical_block(block);
+    if (block_has(next, BLOCK_FENCE) && !block_has(block, BLOCK_PREV_FREE)) {
+        arena_t* arena = *(arena_t**)(next + 1);
+        if (block == arena_first_block(arena) && spare_arena == NULL) {
+            spare_arena = arena;  // The arena is entirely free, keep it as the spare
+        } else if (block == arena_first_block(arena)) {
+            // The arena is entirely free and there already is a spare, unmap it
+            remove_free_block(block);
+            if (arena->prev != NULL) {
+                arena->prev->next = arena->next;
+            } else {
+                arenas = arena->next;
+            }
+            if (arena->next != NULL) {
+                arena->next->prev = arena->prev;
+            }
+            num_arenas--;
+            released_arenas++;
+            if (munmap(arena, arena->size) == -1) {
+                perror("munmap failed");
+            }
+            return 1;
+        }
+    }
+
+    if (block_size(block) < trim_threshold || block_size(block) < 3 * sizeof(size_t)) {
+        block->magic = 0;  // Not tracked, any of its pages may be resident; too small to hold the record
+        return 0;
     }
+    size_t page_size = getpagesize();
+    size_t pad = trim_pad;    // Resident front of the span, the bin links included
+    uintptr_t start = ((uintptr_t)(block + 1) + pad + page_size - 1) & ~(uintptr_t)(page_size - 1);
+    uintptr_t end = ((uintptr_t)(block + 1) + block_size(block)) & ~(uintptr_t)(page_size - 1);
+    if (front_end != NULL) {
+        release_pages((char*)(block + 1), front_end, start, end);
+    }
+    release_pages(dirty_start, dirty_end, start, end);
+    block->magic = RELEASED_MAGIC;
+    *resident_front(block) = pad;
+    return 0;
+}
+
+// Function to set from which size free heap memory is returned to the OS
+// Free blocks of at least this many bytes have their pages released, and arenas that
+// become entirely free are unmapped, except for one spare. SIZE_MAX only unmaps entirely
+// free arenas. The resident front of trimmed spans starts again from at most half the
+// threshold, so a small threshold releases small spans too. Thresholds below a page are
+// raised to a page: a smaller span has no page to release past its resident front.
+void my_set_trim_threshold(size_t bytes) {
+    size_t page_size = getpagesize();
+    if (bytes < page_size) bytes = page_size;
+    pthread_mutex_lock(&heap_lock);
+    trim_threshold = bytes;
+    trim_pad = bytes / 2 < TRIM_PAD ? bytes / 2 : TRIM_PAD;
+    if (trim_pad < page_size) trim_pad = page_size;
+    pthread_mutex_unlock(&heap_lock);
+}
 
-    // Append the allocated block to the free list 
-    append_block_to_free_list(block);
-    
+// Memory allocation functions 
+// Requests a new block of memory from a new heap arena
+// Only the requested size is carved off, the rest of the arena goes into the bins.
+static block_header_t* request_new_heap_block(size_t size) {
+    block_header_t* block = map_new_arena(size);
+    if (block == NULL) {
+        return NULL;  // Out of memory
+    }
+    block = split_block(block, size);  // The rest of the arena becomes a free block
+    mark_block_allocated(block);
     return block;
 }
 
@@ -194,15 +513,170 @@ static block_header_t* request_new_mmap_block(size_t size) {
     }
 
     // Initialize the block header
-    block->size = total_size - sizeof(block_header_t);
-    block->is_free = 0;        // Mark as allocated
-    block->is_mmap = 1;        // Indicate that mmap was used
-    block->next = NULL;        // Not part of the free list
+    block->size = (total_size - sizeof(block_header_t)) | BLOCK_MMAP;  // Allocated, using mmap
+    block->prev_size = 0;      // No neighbours
     block->magic = MAGIC;      // Set the magic number for validation
 
     return block;
 }
 
+// Shared heap functions, called with heap_lock held
+// Allocates a heap block of the given (aligned) size from the bins or a new arena
+static block_header_t* heap_alloc(size_t aligned_size) {
+    // Try to find a suitable free block in the bins
+    block_header_t* block = find_free_block(aligned_size);
+    if (block != NULL) {
+        remove_free_block(block);
+        block = split_block(block, aligned_size);  // Split the block if necessary
+        mark_block_allocated(block);  // Mark block as allocated
+    } else {
+        // No suitable free block found, request a new block from the heap
+        block = request_new_heap_block(aligned_size);
+    }
+    return block;
+}
+
+// Returns an allocated heap block to the bins, merged with its free neighbours
+// Free neighbours that track their released pages only have their resident front to be
+// released again, the rest of the merged span is released as a whole. The pages of the
+// previous block's front and everything from the freed block to the end of the next
+// block's front may be resident. Repeated frees next to a large span then do not release
+// its pages over and over.
+static void heap_free(block_header_t* block) {
+    char* front_end = NULL;                    // End of the resident front of the previous block
+    char* dirty_start = (char*)block;
+    if (block_has(block, BLOCK_PREV_FREE)) {
+        block_header_t* prev = prev_physical_block(block);
+        if (prev->magic == RELEASED_MAGIC) {
+            front_end = (char*)(prev + 1) + *resident_front(prev);
+        } else {
+            dirty_start = (char*)prev;
+        }
+    }
+    char* dirty_end = (char*)(block + 1) + block_size(block);
+    block_header_t* next = next_physical_block(block);
+    if (block_has(next, BLOCK_FREE)) {
+        dirty_end = (char*)(next + 1) + resident_bytes(next);
+    }
+
+    merge_adjacent_free_blocks(&block);
+    mark_block_free(block);  // Mark the block as free
+    insert_free_block(block);
+    trim_free_block(block, front_end, dirty_start, dirty_end);  // Give large free spans back to the OS
+}
+
+// Thread cache functions
+// Moves up to count blocks from the head of a cache list back to the heap
+static void flush_cache_list(thread_cache_t* cache, int cls, int count) {
+    pthread_mutex_lock(&heap_lock);
+    while (count-- > 0 && cache->lists[cls] != NULL) {
+        block_header_t* block = cache->lists[cls];
+        cache->lists[cls] = *next_link(block);
+        cache->counts[cls]--;
+        heap_free(block);
+    }
+    pthread_mutex_unlock(&heap_lock);
+}
+
+// Statistics functions
+// Adds n to a counter of the calling thread, which my_malloc_stats may read meanwhile
+static void stats_add(uint64_t* counter, uint64_t n) {
+    __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
+
+// Reads a counter of any thread
+static uint64_t stats_load(uint64_t* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+// Adds the counters of one thread to a total
+static void stats_accumulate(thread_stats_t* total, thread_stats_t* stats) {
+    total->malloc_calls += stats_load(&stats->malloc_calls);
+    total->free_calls += stats_load(&stats->free_calls);
+    total->bytes_requested += stats_load(&stats->bytes_requested);
+    total->bytes_in_use += stats_load(&stats->bytes_in_use);
+    total->mmap_blocks += stats_load(&stats->mmap_blocks);
+    total->mmap_bytes += stats_load(&stats->mmap_bytes);
+}
+
+// Returns every cached block of an exiting thread to the heap
+static void flush_thread_cache(void* arg) {
+    thread_cache_t* cache = (thread_cache_t*)arg;
+    for (int cls = 0; cls < NUM_SMALL_BINS; cls++) {
+        flush_cache_list(cache, cls, cache->counts[cls]);
+    }
+
+    // Keep the counters of the thread and take it out of the list of running threads
+    pthread_mutex_lock(&heap_lock);
+    stats_accumulate(&retired_stats, &cache->stats);
+    memset(&cache->stats, 0, sizeof(cache->stats));
+    if (cache->prev != NULL) {
+        cache->prev->next = cache->next;
+    } else {
+        thread_caches = cache->next;
+    }
+    if (cache->next != NULL) {
+        cache->next->prev = cache->prev;
+    }
+    pthread_mutex_unlock(&heap_lock);
+    cache->registered = 0;  // A later free in another destructor arms it again
+}
+
+// Creates the key whose destructor flushes thread caches
+static void create_thread_cache_key(void) {
+    pthread_key_create(&thread_cache_key, flush_thread_cache);
+}
+
+// Returns the cache of the calling thread, arming its exit destructor on first use
+static thread_cache_t* get_thread_cache(void) {
+    thread_cache_t* cache = &thread_cache;
+    if (!cache->registered) {
+        pthread_once(&thread_cache_once, create_thread_cache_key);
+        pthread_setspecific(thread_cache_key, cache);
+        pthread_mutex_lock(&heap_lock);
+        cache->prev = NULL;
+        cache->next = thread_caches;
+        if (thread_caches != NULL) {
+            thread_caches->prev = cache;
+        }
+        thread_caches = cache;
+        pthread_mutex_unlock(&heap_lock);
+        cache->registered = 1;
+    }
+    return cache;
+}
+
+// Counts an allocation of the calling thread and runs the sampling hook when it is due
+static void count_allocation(thread_cache_t* cache, block_header_t* block, size_t size) {
+    stats_add(&cache->stats.malloc_calls, 1);
+    stats_add(&cache->stats.bytes_requested, size);
+    stats_add(&cache->stats.bytes_in_use, block_size(block));
+    my_malloc_sample_hook_t hook = __atomic_load_n(&sample_hook, __ATOMIC_RELAXED);
+    if (hook != NULL && cache->sample_countdown-- == 0) {
+        cache->sample_countdown = __atomic_load_n(&sample_period, __ATOMIC_RELAXED) - 1;
+        hook((void*)(block + 1), size);
+    }
+}
+
+// Fills an empty cache list with a batch of blocks of one size class from the heap
+// Returns 0 if the heap could not provide a single block.
+static int refill_cache_list(thread_cache_t* cache, int cls) {
+    size_t size = (size_t)(cls + 1) * ALIGNMENT;
+    pthread_mutex_lock(&heap_lock);
+    for (int i = 0; i < THREAD_CACHE_BATCH; i++) {
+        block_header_t* block = heap_alloc(size);
+        if (block == NULL) {
+            break;  // Out of memory, hand out what was gathered
+        }
+        block->magic = 0;  // Cached blocks are not valid to free
+        *next_link(block) = cache->lists[cls];
+        cache->lists[cls] = block;
+        cache->counts[cls]++;
+    }
+    pthread_mutex_unlock(&heap_lock);
+    return cache->lists[cls] != NULL;
+}
+
 // Function to allocate memory
 void* my_malloc(size_t size) {
     if (size == 0) {
@@ -210,6 +684,7 @@ void* my_malloc(size_t size) {
     }
 
     size_t aligned_size = align_size(size);  // Align the requested size
+    thread_cache_t* cache = get_thread_cache();
     block_header_t* block;
 
     if (aligned_size >= MMAP_THRESHOLD) {
@@ -218,21 +693,27 @@ void* my_malloc(size_t size) {
         if (block == NULL) {
             return NULL;  // mmap allocation failed
         }
+        stats_add(&cache->stats.mmap_blocks, 1);
+        stats_add(&cache->stats.mmap_bytes, block_size(block) + sizeof(block_header_t));
+    } else if (aligned_size <= SMALL_BIN_LIMIT) {
+        // Small allocations come from the thread cache, refilled from the heap when empty
+        int cls = bin_index(aligned_size);
+        if (cache->lists[cls] == NULL && !refill_cache_list(cache, cls)) {
+            return NULL;  // Heap allocation failed
+        }
+        block = cache->lists[cls];
+        cache->lists[cls] = *next_link(block);
+        cache->counts[cls]--;
     } else {
-        // Try to find a suitable free block in the free list
-        block = find_free_block(aligned_size);
-        if (block != NULL) {
-            block = split_block(block, aligned_size);  // Split the block if necessary
-            block->is_free = 0;      // Mark block as allocated
-            block->magic = MAGIC;    // Set the magic number
-        } else {
-            // No suitable free block found, request a new block from the heap
-            block = request_new_heap_block(aligned_size);
-            if (block == NULL) {
-                return NULL;  // Heap allocation failed
-            }
+        pthread_mutex_lock(&heap_lock);
+        block = heap_alloc(aligned_size);
+        pthread_mutex_unlock(&heap_lock);
+        if (block == NULL) {
+            return NULL;  // Heap allocation failed
         }
     }
+    block->magic = MAGIC;    // Set the magic number
+    count_allocation(cache, block, size);
     return (void*)(block + 1);  // Return the memory after the block header
 }
 
@@ -243,8 +724,8 @@ void* my_calloc(size_t nelem, size_t size) {
         return NULL;  // Check for overflow in multiplication
     }
     void* ptr = my_malloc(total_size);  // Allocate memory
-    if (ptr != NULL) {
-        memset(ptr, 0, total_size);  // Initialize the allocated memory to zero
+    if (ptr != NULL && !block_has(((block_header_t*)ptr) - 1, BLOCK_MMAP)) {
+        memset(ptr, 0, total_size);  // Initialize the allocated memory to zero, fresh mmap pages already are
     }
     return ptr;
 }
@@ -264,18 +745,398 @@ void my_free(void* ptr) {
         return;
     }
 
-    if (block->is_mmap) {
+    thread_cache_t* cache = get_thread_cache();
+    stats_add(&cache->stats.free_calls, 1);
+    stats_add(&cache->stats.bytes_in_use, -(uint64_t)block_size(block));
+
+    if (block_has(block, BLOCK_MMAP)) {
         // The block was allocated using mmap, so use munmap to deallocate it
-        size_t total_size = block->size + sizeof(block_header_t);
+        size_t total_size = block_size(block) + sizeof(block_header_t);
+        stats_add(&cache->stats.mmap_blocks, -(uint64_t)1);
+        stats_add(&cache->stats.mmap_bytes, -(uint64_t)total_size);
         if (munmap(block, total_size) == -1) {
             perror("munmap failed");
         }
+    } else if (block_size(block) <= SMALL_BIN_LIMIT) {
+        // Small blocks go to the cache of the freeing thread, whichever thread allocated them
+        block->magic = 0;       // Invalidate the magic number
+        int cls = bin_index(block_size(block));
+        *next_link(block) = cache->lists[cls];
+        cache->lists[cls] = block;
+        if (++cache->counts[cls] > THREAD_CACHE_LIMIT) {
+            flush_cache_list(cache, cls, THREAD_CACHE_BATCH);  // Keep the cache bounded
+        }
     } else {
         // The block was allocated from the internal heap
-        block->is_free = 1;     // Mark the block as free
         block->magic = 0;       // Invalidate the magic number
 
-        // Attempt to merge with adjacent free blocks
-        merge_adjacent_free_blocks(&block);
+        // Attempt to merge with adjacent free blocks, then return the result to its bin
+        pthread_mutex_lock(&heap_lock);
+        heap_free(block);
+        pthread_mutex_unlock(&heap_lock);
+    }
+}
+
+// Resizes a heap block in place, with heap_lock held
+// Shrinking splits off the tail if it can form a block; growing absorbs the physically
+// next block if it is free and large enough. Returns 0 if the block cannot grow in place.
+static int resize_heap_block(block_header_t* block, size_t aligned_size) {
+    size_t old_size = block_size(block);
+    if (aligned_size > old_size) {
+        block_header_t* next = next_physical_block(block);
+        size_t available = old_size + sizeof(block_header_t) + block_size(next);
+        if (!block_has(next, BLOCK_FREE) || available < aligned_size) {
+            return 0;  // No room after the block
+        }
+        remove_free_block(next);
+        set_block_size(block, available);
+        old_size = available;
+    }
+
+    split_block(block, aligned_size);  // The tail, if any, becomes a free block
+    if (block_size(block) != old_size) {
+        // Merge the new free tail with a free block after it
+        block_header_t* tail = next_physical_block(block);
+        remove_free_block(tail);
+        merge_with_next_block(tail);
+        mark_block_free(tail);
+        insert_free_block(tail);
+    }
+    mark_block_allocated(block);
+    return 1;
+}
+
+// Function to change the size of memory allocated using my_malloc and my_calloc
+// Blocks that stay above MMAP_THRESHOLD are resized with mremap, which moves pages
+// instead of copying them. Heap blocks shrink in place and grow in place when the block
+// after them is free. Otherwise the contents move to a new block. Returns NULL, leaving
+// the old block untouched, if no memory is available.
+void* my_realloc(void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return my_malloc(size);  // Same as malloc
+    }
+    if (size == 0) {
+        my_free(ptr);  // Same as free
+        return NULL;
+    }
+
+    // Get the block header from the user pointer
+    block_header_t* block = ((block_header_t*)ptr) - 1;
+
+    // Validate the magic number to detect invalid realloc operations
+    if (block->magic != MAGIC) {
+        fprintf(stderr, "Invalid realloc detected at block %p!\n", block);
+        return NULL;
+    }
+
+    size_t aligned_size = align_size(size);  // Align the requested size
+    thread_cache_t* cache = get_thread_cache();
+    size_t old_size = block_size(block);
+    int is_mmap = block_has(block, BLOCK_MMAP);
+    if (is_mmap && aligned_size >= MMAP_THRESHOLD) {
+        size_t old_total = block_size(block) + sizeof(block_header_t);
+        size_t new_total = align_to_page(aligned_size + sizeof(block_header_t));  // Align to page size
+        if (new_total == old_total) {
+            return ptr;  // Still fits in the same pages
+        }
+        void* moved = (void*)syscall(SYS_mremap, block, old_total, new_total, MREMAP_MAYMOVE);
+        if (moved != MAP_FAILED) {
+            block = (block_header_t*)moved;
+            set_block_size(block, new_total - sizeof(block_header_t));
+            stats_add(&cache->stats.mmap_bytes, new_total - old_total);
+            stats_add(&cache->stats.bytes_in_use, new_total - old_total);
+            return (void*)(block + 1);
+        }
+    } else if (!is_mmap && aligned_size < MMAP_THRESHOLD) {
+        pthread_mutex_lock(&heap_lock);
+        int resized = resize_heap_block(block, aligned_size);
+        size_t new_size = block_size(block);
+        pthread_mutex_unlock(&heap_lock);
+        if (resized) {
+            stats_add(&cache->stats.bytes_in_use, new_size - old_size);
+            return ptr;
+        }
+    }
+
+    // Move the contents to a new block
+    void* new_ptr = my_malloc(size);
+    if (new_ptr == NULL) {
+        return NULL;  // Out of memory, the old block stays valid
+    }
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    my_free(ptr);
+    return new_ptr;
+}
+
+// Statistics reported by my_malloc_stats
+typedef struct my_malloc_stats {
+    uint64_t malloc_calls;               // Successful calls of my_malloc and my_calloc
+    uint64_t free_calls;                 // Blocks released by my_free
+    uint64_t bytes_requested;            // Sum of the sizes asked for, since the start
+    size_t bytes_in_use;                 // Payload of the live blocks, after alignment
+    size_t bytes_mapped;                 // Memory mapped for heap arenas and mmap blocks
+    size_t heap_mapped;                  // Memory mapped for heap arenas
+    int num_arenas;                      // Heap arenas currently mapped
+    size_t heap_free_bytes;              // Payload of the free heap blocks in the bins
+    size_t largest_free_block;           // Payload of the largest of them
+    size_t mmap_mapped;                  // Memory mapped for blocks of their own
+    size_t mmap_blocks;                  // Number of those blocks
+    size_t bin_blocks[NUM_BINS];         // Free blocks in each bin
+    double fragmentation;                // 1 - largest_free_block / heap_free_bytes, 0 without free blocks
+    double avg_search_length;            // Free blocks looked at per search of the bins
+} my_malloc_stats_t;
+
+// Function to report the state of the allocator
+// Takes heap_lock and walks the bins, so it is meant for diagnostics rather than hot
+// paths. Counters of other threads are read while they run and may be slightly behind.
+// Blocks in thread caches count as in use for the heap but not in bytes_in_use, and
+// slabs are not included.
+void my_malloc_stats(my_malloc_stats_t* stats) {
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&heap_lock);
+    thread_stats_t total = retired_stats;
+    for (thread_cache_t* cache = thread_caches; cache != NULL; cache = cache->next) {
+        stats_accumulate(&total, &cache->stats);
+    }
+    for (arena_t* arena = arenas; arena != NULL; arena = arena->next) {
+        stats->heap_mapped += arena->size;
+    }
+    stats->num_arenas = num_arenas;
+    for (int b = 0; b < NUM_BINS; b++) {
+        for (block_header_t* block = bins[b]; block != NULL; block = *next_link(block)) {
+            stats->bin_blocks[b]++;
+            stats->heap_free_bytes += block_size(block);
+            if (block_size(block) > stats->largest_free_block) {
+                stats->largest_free_block = block_size(block);
+            }
+        }
+    }
+    if (free_list_searches > 0) {
+        stats->avg_search_length = (double)free_list_steps / free_list_searches;
+    }
+    pthread_mutex_unlock(&heap_lock);
+
+    stats->malloc_calls = total.malloc_calls;
+    stats->free_calls = total.free_calls;
+    stats->bytes_requested = total.bytes_requested;
+    stats->bytes_in_use = total.bytes_in_use;
+    stats->mmap_blocks = total.mmap_blocks;
+    stats->mmap_mapped = total.mmap_bytes;
+    stats->bytes_mapped = stats->heap_mapped + stats->mmap_mapped;
+    if (stats->heap_free_bytes > 0) {
+        stats->fragmentation = 1.0 - (double)stats->largest_free_block / stats->heap_free_bytes;
+    }
+}
+
+// Function to print the statistics of the allocator in a readable form
+void my_malloc_stats_print(FILE* out) {
+    my_malloc_stats_t stats;
+    my_malloc_stats(&stats);
+    fprintf(out, "calls: %lu malloc, %lu free, %lu bytes requested\n",
+            (unsigned long)stats.malloc_calls, (unsigned long)stats.free_calls, (unsigned long)stats.bytes_requested);
+    fprintf(out, "in use: %zu bytes, mapped: %zu bytes (heap %zu in %d arenas, mmap %zu in %zu blocks)\n",
+            stats.bytes_in_use, stats.bytes_mapped, stats.heap_mapped, stats.num_arenas, stats.mmap_mapped, stats.mmap_blocks);
+    fprintf(out, "heap free: %zu bytes, largest %zu, fragmentation %.3f, search length %.2f\n",
+            stats.heap_free_bytes, stats.largest_free_block, stats.fragmentation, stats.avg_search_length);
+    fprintf(out, "free blocks per bin:");
+    for (int b = 0; b < NUM_BINS; b++) {
+        if (stats.bin_blocks[b] > 0) {
+            fprintf(out, " %d:%zu", b, stats.bin_blocks[b]);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+// Function to call a hook on one allocation out of every period
+// The hook gets the pointer returned and the size asked for, on the allocating thread,
+// after every period-th allocation of that thread. It must not call my_malloc. A NULL
+// hook or a period of 0 turns sampling off; otherwise a check per allocation is the only cost.
+void my_set_sample_hook(my_malloc_sample_hook_t hook, uint64_t period) {
+    if (period == 0) {
+        hook = NULL;
+    }
+    __atomic_store_n(&sample_period, period, __ATOMIC_RELAXED);
+    __atomic_store_n(&sample_hook, hook, __ATOMIC_RELAXED);
+}
+
+// Fixed-size object slabs
+// A slab hands out objects of a single size packed into SLAB_PAGE_SIZE pages with no
+// per-object header. Pages are aligned to their size, so the page of an object is found
+// by masking its address; the page header at the start records the slab it belongs to.
+// Pages with room are kept on the partial list and pages with every object in use on
+// the full list. One page that became empty is kept for reuse, any other is unmapped.
+typedef struct slab_page {
+    struct my_slab* slab;                // Slab the page belongs to
+    struct slab_page* next;              // Next page in the same list
+    struct slab_page* prev;              // Previous page in the same list
+    void* free_objects;                  // Freed objects, linked through their first word
+    char* unused;                        // First object never handed out, objects after it are unused too
+    size_t in_use;                       // Number of objects handed out and not freed
+} slab_page_t;
+
+typedef struct my_slab {
+    size_t obj_size;                     // Size of each object, rounded up to the word size
+    size_t per_page;                     // Objects that fit in a page after its header
+    slab_page_t* partial;                // Pages with at least one object available
+    slab_page_t* full;                   // Pages with every object in use
+    slab_page_t* spare;                  // Empty page kept for reuse, or NULL
+    pthread_mutex_t lock;                // Guards the page lists of this slab
+} my_slab_t;
+
+// Returns the address of the first object of a slab page
+static char* slab_page_objects(slab_page_t* page) {
+    return (char*)page + align_size(sizeof(slab_page_t));
+}
+
+// Adds a page at the head of a page list
+static void slab_list_push(slab_page_t** list, slab_page_t* page) {
+    page->prev = NULL;
+    page->next = *list;
+    if (*list != NULL) {
+        (*list)->prev = page;
+    }
+    *list = page;
+}
+
+// Takes a page out of a page list
+static void slab_list_remove(slab_page_t** list, slab_page_t* page) {
+    if (page->prev != NULL) {
+        page->prev->next = page->next;
+    } else {
+        *list = page->next;
+    }
+    if (page->next != NULL) {
+        page->next->prev = page->prev;
+    }
+}
+
+// Maps a new page aligned to SLAB_PAGE_SIZE for a slab
+// Twice the page size is mapped and the misaligned ends are unmapped again.
+static slab_page_t* map_slab_page(my_slab_t* slab) {
+    char* mapped = mmap(NULL, 2 * SLAB_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        perror("mmap failed");
+        return NULL;
+    }
+    char* start = (char*)(((uintptr_t)mapped + SLAB_PAGE_SIZE - 1) & ~(uintptr_t)(SLAB_PAGE_SIZE - 1));
+    if (start > mapped) {
+        munmap(mapped, start - mapped);
+    }
+    if (start + SLAB_PAGE_SIZE < mapped + 2 * SLAB_PAGE_SIZE) {
+        munmap(start + SLAB_PAGE_SIZE, mapped + 2 * SLAB_PAGE_SIZE - (start + SLAB_PAGE_SIZE));
+    }
+
+    slab_page_t* page = (slab_page_t*)start;
+    page->slab = slab;
+    page->free_objects = NULL;
+    page->unused = slab_page_objects(page);
+    page->in_use = 0;
+    return page;
+}
+
+// Unmaps a slab page
+static void unmap_slab_page(slab_page_t* page) {
+    if (munmap(page, SLAB_PAGE_SIZE) == -1) {
+        perror("munmap failed");
+    }
+}
+
+// Function to create a slab of objects of the given size
+// Returns NULL if the size is 0, larger than SLAB_MAX_OBJECT, or no memory is available.
+// Objects are aligned to the word size, and to ALIGNMENT when obj_size is a multiple of it.
+my_slab_t* my_slab_create(size_t obj_size) {
+    if (obj_size == 0 || obj_size > SLAB_MAX_OBJECT) {
+        return NULL;  // Use my_malloc for large objects
+    }
+    my_slab_t* slab = my_malloc(sizeof(my_slab_t));
+    if (slab == NULL) {
+        return NULL;
+    }
+    slab->obj_size = (obj_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);  // Room for the free link
+    slab->per_page = (SLAB_PAGE_SIZE - align_size(sizeof(slab_page_t))) / slab->obj_size;
+    slab->partial = NULL;
+    slab->full = NULL;
+    slab->spare = NULL;
+    pthread_mutex_init(&slab->lock, NULL);
+    return slab;
+}
+
+// Function to allocate one object from a slab
+void* my_slab_alloc(my_slab_t* slab) {
+    pthread_mutex_lock(&slab->lock);
+    slab_page_t* page = slab->partial;
+    if (page == NULL) {
+        // Every page is full, reuse the spare page or map a new one
+        page = slab->spare != NULL ? slab->spare : map_slab_page(slab);
+        if (page == NULL) {
+            pthread_mutex_unlock(&slab->lock);
+            return NULL;  // mmap failed
+        }
+        slab->spare = NULL;
+        slab_list_push(&slab->partial, page);
+    }
+
+    void* object;
+    if (page->free_objects != NULL) {
+        object = page->free_objects;
+        page->free_objects = *(void**)object;
+    } else {
+        object = page->unused;   // The page is not full, so an unused object is left
+        page->unused += slab->obj_size;
+    }
+    if (++page->in_use == slab->per_page) {
+        slab_list_remove(&slab->partial, page);
+        slab_list_push(&slab->full, page);
+    }
+    pthread_mutex_unlock(&slab->lock);
+    return object;
+}
+
+// Function to return an object to the slab it was allocated from
+void my_slab_free(my_slab_t* slab, void* ptr) {
+    if (ptr == NULL) {
+        return;  // Nothing to free
+    }
+
+    // The page header is at the start of the aligned page holding the object
+    slab_page_t* page = (slab_page_t*)((uintptr_t)ptr & ~(uintptr_t)(SLAB_PAGE_SIZE - 1));
+    if (page->slab != slab) {
+        fprintf(stderr, "Invalid slab free detected at object %p!\n", ptr);
+        return;
+    }
+
+    pthread_mutex_lock(&slab->lock);
+    *(void**)ptr = page->free_objects;
+    page->free_objects = ptr;
+    if (page->in_use-- == slab->per_page) {
+        slab_list_remove(&slab->full, page);
+        slab_list_push(&slab->partial, page);
+    }
+    if (page->in_use == 0) {
+        // Keep one empty page to avoid remapping when the slab refills, unmap the others
+        slab_list_remove(&slab->partial, page);
+        if (slab->spare == NULL) {
+            page->free_objects = NULL;   // Start over with every object unused
+            page->unused = slab_page_objects(page);
+            slab->spare = page;
+        } else {
+            unmap_slab_page(page);
+        }
+    }
+    pthread_mutex_unlock(&slab->lock);
+}
+
+// Function to release a slab and every page it holds, including objects still in use
+void my_slab_destroy(my_slab_t* slab) {
+    slab_page_t* lists[] = {slab->partial, slab->full, slab->spare};
+    for (int l = 0; l < 3; l++) {
+        slab_page_t* page = lists[l];
+        while (page != NULL) {
+            slab_page_t* next = l < 2 ? page->next : NULL;  // The spare page is not on a list
+            unmap_slab_page(page);
+            page = next;
+        }
     }
+    pthread_mutex_destroy(&slab->lock);
+    my_free(slab);
 }
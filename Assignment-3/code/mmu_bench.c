@@ -0,0 +1,149 @@
+// Scaling benchmark of my_malloc against the C library malloc
+// Build: gcc -O2 -pthread mmu_bench.c -o mmu_bench
+// Usage: ./mmu_bench [operations per thread] [max threads]
+//
+// Two workloads run at 1, 2, 4, ... max threads (64 by default):
+//   local  - every thread allocates and frees small blocks of random size, keeping a
+//            window of live blocks, so every block is freed by the thread that made it
+//   remote - threads allocate a batch, swap batches with a partner at a barrier and free
+//            the partner's blocks, so every block is freed by another thread
+// Throughput is reported in million malloc+free pairs per second over all threads.
+
+#include "2021MT60949mmu.h"
+#include <time.h>
+
+#define LIVE_WINDOW 256   // Blocks each thread keeps alive in the local workload
+#define REMOTE_BATCH 1024 // Blocks handed to the partner thread per round in the remote workload
+#define MAX_SMALL 512     // Largest request size, the range served by the thread caches
+
+// Allocator under test
+typedef struct {
+    const char* name;
+    void* (*alloc)(size_t);
+    void (*release)(void*);
+} allocator_t;
+
+// Arguments of one benchmark thread
+typedef struct {
+    const allocator_t* allocator;
+    long operations;              // malloc+free pairs to perform
+    int id;                       // Index of the thread
+    int num_threads;
+    void** batches;               // REMOTE_BATCH slots per thread, for the remote workload
+    pthread_barrier_t* barrier;   // Rounds of the remote workload
+} bench_args_t;
+
+// Function to get a pseudo-random number without shared state
+static unsigned next_random(unsigned* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Function to run the local workload on one thread
+static void* local_worker(void* arg) {
+    bench_args_t* args = (bench_args_t*)arg;
+    void* live[LIVE_WINDOW] = {0};
+    unsigned state = 2463534242u + args->id;
+    for (long i = 0; i < args->operations; i++) {
+        int slot = next_random(&state) % LIVE_WINDOW;
+        if (live[slot] != NULL) {
+            args->allocator->release(live[slot]);
+        }
+        live[slot] = args->allocator->alloc(1 + next_random(&state) % MAX_SMALL);
+        *(char*)live[slot] = (char)i;  // Touch the block like a real user would
+    }
+    for (int slot = 0; slot < LIVE_WINDOW; slot++) {
+        args->allocator->release(live[slot]);
+    }
+    return NULL;
+}
+
+// Function to run the remote workload on one thread
+static void* remote_worker(void* arg) {
+    bench_args_t* args = (bench_args_t*)arg;
+    void** mine = args->batches + (size_t)args->id * REMOTE_BATCH;
+    int partner = args->id ^ 1;  // Threads are paired, a lone thread frees its own batch
+    if (partner >= args->num_threads) partner = args->id;
+    void** theirs = args->batches + (size_t)partner * REMOTE_BATCH;
+    unsigned state = 2463534242u + args->id;
+
+    for (long done = 0; done < args->operations; done += REMOTE_BATCH) {
+        for (int k = 0; k < REMOTE_BATCH; k++) {
+            mine[k] = args->allocator->alloc(1 + next_random(&state) % MAX_SMALL);
+            *(char*)mine[k] = (char)k;
+        }
+        pthread_barrier_wait(args->barrier);  // Every batch is filled
+        for (int k = 0; k < REMOTE_BATCH; k++) {
+            args->allocator->release(theirs[k]);
+        }
+        pthread_barrier_wait(args->barrier);  // Every batch is freed before it is refilled
+    }
+    return NULL;
+}
+
+// Function to get the time of the monotonic clock in seconds
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Function to run one workload with the given number of threads, returns pairs per second
+static double run_workload(const allocator_t* allocator, void* (*worker)(void*), int num_threads, long operations) {
+    pthread_t* threads = malloc(num_threads * sizeof(pthread_t));
+    bench_args_t* args = malloc(num_threads * sizeof(bench_args_t));
+    void** batches = malloc((size_t)num_threads * REMOTE_BATCH * sizeof(void*));
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, num_threads);
+
+    double start = now_seconds();
+    for (int t = 0; t < num_threads; t++) {
+        args[t].allocator = allocator;
+        args[t].operations = operations;
+        args[t].id = t;
+        args[t].num_threads = num_threads;
+        args[t].batches = batches;
+        args[t].barrier = &barrier;
+        pthread_create(&threads[t], NULL, worker, &args[t]);
+    }
+    for (int t = 0; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    pthread_barrier_destroy(&barrier);
+    free(batches);
+    free(args);
+    free(threads);
+    return (double)operations * num_threads / elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    long operations = argc > 1 ? atol(argv[1]) : 1000000;
+    int max_threads = argc > 2 ? atoi(argv[2]) : 64;
+    const allocator_t allocators[] = {
+        {"my_malloc", my_malloc, my_free},
+        {"malloc", malloc, free},
+    };
+    struct {
+        const char* name;
+        void* (*worker)(void*);
+    } workloads[] = {
+        {"local", local_worker},
+        {"remote", remote_worker},
+    };
+
+    printf("%-8s %-8s %-10s %12s\n", "threads", "workload", "allocator", "Mpairs/s");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        for (int w = 0; w < 2; w++) {
+            for (int a = 0; a < 2; a++) {
+                double rate = run_workload(&allocators[a], workloads[w].worker, threads, operations);
+                printf("%-8d %-8s %-10s %12.2f\n", threads, workloads[w].name, allocators[a].name, rate / 1e6);
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
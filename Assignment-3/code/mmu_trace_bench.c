@@ -0,0 +1,425 @@
+// Workload benchmark of my_malloc against the C library malloc
+// Build: gcc -O2 -pthread mmu_trace_bench.c -o mmu_trace_bench
+// Usage: ./mmu_trace_bench [operations] [mtrace log ...]
+//
+// Every workload runs in a child process of its own for each allocator, so the peak
+// resident set size reported by wait4 belongs to that run alone:
+//   bursty   - allocate a burst of blocks of mixed size, free nearly all of them, repeat
+//   prodcons - one thread allocates messages that another thread frees
+//   lifetime - mostly short-lived blocks mixed with a few that live for the whole run
+//   <file>   - replay of a log written by glibc mtrace(), with the MALLOC_TRACE variable
+// Throughput is reported in million operations per second, an operation being one call
+// of malloc, free or realloc. The statistics of my_malloc are printed after its runs.
+
+#include "2021MT60949mmu.h"
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BURST_SIZE 20000        // Blocks allocated per burst
+#define BURST_KEEP 16           // One block out of this many survives each burst
+#define QUEUE_SIZE 4096         // Messages in flight between producer and consumer
+#define LIFETIME_SLOTS 4096     // Short-lived blocks alive at a time
+#define LONG_LIVED_ONE_IN 64    // One allocation out of this many lives until the end
+
+// Allocator under test
+typedef struct {
+    const char* name;
+    void* (*alloc)(size_t);
+    void (*release)(void*);
+    void* (*resize)(void*, size_t);
+} allocator_t;
+
+// One operation of a replayed trace, on a slot standing for a live pointer
+typedef struct {
+    char type;                  // 'm' malloc, 'f' free, 'r' realloc
+    unsigned slot;
+    size_t size;
+} trace_op_t;
+
+// Trace loaded from an mtrace log
+typedef struct {
+    trace_op_t* ops;
+    size_t num_ops;
+    unsigned num_slots;         // Slots needed to hold every pointer live at once
+} trace_t;
+
+// Function to get a pseudo-random number without shared state
+static unsigned next_random(unsigned* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Function to get a request size: mostly small, sometimes up to 64 KB
+static size_t random_size(unsigned* state) {
+    unsigned r = next_random(state);
+    if (r % 16 != 0) return 1 + r / 16 % 512;
+    if (r % 256 != 0) return 1 + r / 256 % 8192;
+    return 1 + r / 256 % 65536;
+}
+
+// Function to get the time of the monotonic clock in seconds
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Function to run the bursty workload, returns the number of operations done
+static long run_bursty(const allocator_t* a, long operations) {
+    void** blocks = malloc(BURST_SIZE * sizeof(void*));
+    void** kept = malloc((operations / BURST_KEEP + BURST_SIZE) * sizeof(void*));
+    long done = 0, num_kept = 0;
+    unsigned state = 2463534242u;
+    while (done < operations) {
+        for (int k = 0; k < BURST_SIZE; k++) {
+            blocks[k] = a->alloc(random_size(&state));
+            *(char*)blocks[k] = (char)k;
+        }
+        for (int k = 0; k < BURST_SIZE; k++) {
+            if (k % BURST_KEEP == 0) {
+                kept[num_kept++] = blocks[k];  // Survivors pin parts of the heap
+            } else {
+                a->release(blocks[k]);
+            }
+        }
+        done += 2 * BURST_SIZE - BURST_SIZE / BURST_KEEP;
+    }
+    for (long k = 0; k < num_kept; k++) {
+        a->release(kept[k]);
+    }
+    free(kept);
+    free(blocks);
+    return done + num_kept;
+}
+
+// Queue between the producer and the consumer thread
+typedef struct {
+    const allocator_t* allocator;
+    long messages;
+    void* slots[QUEUE_SIZE];
+    long head;                  // Messages taken by the consumer
+    long tail;                  // Messages put by the producer
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} message_queue_t;
+
+// Function to free every message the producer sends
+static void* consumer_thread(void* arg) {
+    message_queue_t* q = (message_queue_t*)arg;
+    for (long i = 0; i < q->messages; i++) {
+        pthread_mutex_lock(&q->lock);
+        while (q->head == q->tail) {
+            pthread_cond_wait(&q->changed, &q->lock);
+        }
+        void* message = q->slots[q->head % QUEUE_SIZE];
+        if (q->tail - q->head++ == QUEUE_SIZE) {
+            pthread_cond_signal(&q->changed);  // The producer waits for room
+        }
+        pthread_mutex_unlock(&q->lock);
+        q->allocator->release(message);
+    }
+    return NULL;
+}
+
+// Function to run the producer-consumer workload, returns the number of operations done
+static long run_prodcons(const allocator_t* a, long operations) {
+    message_queue_t* q = malloc(sizeof(message_queue_t));
+    q->allocator = a;
+    q->messages = operations / 2;
+    q->head = q->tail = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->changed, NULL);
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, consumer_thread, q);
+
+    unsigned state = 2463534242u;
+    for (long i = 0; i < q->messages; i++) {
+        void* message = a->alloc(random_size(&state));
+        *(char*)message = (char)i;
+        pthread_mutex_lock(&q->lock);
+        while (q->tail - q->head == QUEUE_SIZE) {
+            pthread_cond_wait(&q->changed, &q->lock);
+        }
+        q->slots[q->tail % QUEUE_SIZE] = message;
+        if (q->tail++ == q->head) {
+            pthread_cond_signal(&q->changed);  // The consumer waits for a message
+        }
+        pthread_mutex_unlock(&q->lock);
+    }
+    pthread_join(consumer, NULL);
+    pthread_cond_destroy(&q->changed);
+    pthread_mutex_destroy(&q->lock);
+    free(q);
+    return 2 * (operations / 2);
+}
+
+// Function to run the mixed lifetime workload, returns the number of operations done
+static long run_lifetime(const allocator_t* a, long operations) {
+    void* slots[LIFETIME_SLOTS] = {0};
+    void** long_lived = malloc((operations / LONG_LIVED_ONE_IN + 1) * sizeof(void*));
+    long num_long = 0, done = 0;
+    unsigned state = 2463534242u;
+    for (long i = 0; i < operations / 2; i++) {
+        void* block = a->alloc(random_size(&state));
+        *(char*)block = (char)i;
+        if (next_random(&state) % LONG_LIVED_ONE_IN == 0) {
+            long_lived[num_long++] = block;
+            done++;
+            continue;
+        }
+        int slot = next_random(&state) % LIFETIME_SLOTS;
+        if (slots[slot] != NULL) {
+            a->release(slots[slot]);
+            done++;
+        }
+        slots[slot] = block;
+        done++;
+    }
+    for (int slot = 0; slot < LIFETIME_SLOTS; slot++) {
+        if (slots[slot] != NULL) {
+            a->release(slots[slot]);
+            done++;
+        }
+    }
+    for (long k = 0; k < num_long; k++) {
+        a->release(long_lived[k]);
+    }
+    free(long_lived);
+    return done + num_long;
+}
+
+// Function to parse a hexadecimal number, returns the character after it
+static const char* parse_hex(const char* s, size_t* value) {
+    *value = 0;
+    if (s[0] == '0' && s[1] == 'x') s += 2;
+    for (;; s++) {
+        int digit;
+        if (*s >= '0' && *s <= '9') digit = *s - '0';
+        else if (*s >= 'a' && *s <= 'f') digit = *s - 'a' + 10;
+        else if (*s >= 'A' && *s <= 'F') digit = *s - 'A' + 10;
+        else return s;
+        *value = *value * 16 + digit;
+    }
+}
+
+// Address map of a trace being loaded, open addressing with linear probing
+typedef struct {
+    size_t* addresses;          // 0 marks an empty entry
+    unsigned* slots;
+    size_t capacity;            // Power of two
+    size_t used;
+} address_map_t;
+
+// Function to find the entry of an address, or the empty entry where it belongs
+static size_t address_map_find(address_map_t* map, size_t address) {
+    size_t i = (address >> 4) * 0x9E3779B97F4A7C15ULL & (map->capacity - 1);
+    while (map->addresses[i] != 0 && map->addresses[i] != address) {
+        i = (i + 1) & (map->capacity - 1);
+    }
+    return i;
+}
+
+// Function to remove the entry at index i, moving later entries of its run back
+static void address_map_erase(address_map_t* map, size_t i) {
+    size_t j = i;
+    map->addresses[i] = 0;
+    map->used--;
+    for (;;) {
+        j = (j + 1) & (map->capacity - 1);
+        if (map->addresses[j] == 0) return;
+        size_t address = map->addresses[j];
+        unsigned slot = map->slots[j];
+        map->addresses[j] = 0;
+        size_t k = address_map_find(map, address);
+        map->addresses[k] = address;
+        map->slots[k] = slot;
+    }
+}
+
+// Function to add an address, growing the map when it is half full
+static void address_map_insert(address_map_t* map, size_t address, unsigned slot) {
+    if (2 * (map->used + 1) > map->capacity) {
+        address_map_t bigger = {calloc(2 * map->capacity, sizeof(size_t)),
+                                malloc(2 * map->capacity * sizeof(unsigned)), 2 * map->capacity, 0};
+        if (bigger.addresses == NULL || bigger.slots == NULL) {
+            perror("malloc failed");
+            exit(1);
+        }
+        for (size_t i = 0; i < map->capacity; i++) {
+            if (map->addresses[i] != 0) address_map_insert(&bigger, map->addresses[i], map->slots[i]);
+        }
+        free(map->addresses);
+        free(map->slots);
+        *map = bigger;
+    }
+    size_t i = address_map_find(map, address);
+    if (map->addresses[i] == 0) map->used++;
+    map->addresses[i] = address;
+    map->slots[i] = slot;
+}
+
+// Function to load an mtrace log
+// Lines look like "@ prog:[0x401136] + 0x4052a0 0x64" for malloc, "- 0x4052a0" for free,
+// and "< 0x4052a0" followed by "> 0x405710 0xc8" for realloc. Frees of blocks allocated
+// before tracing started are skipped. Every pointer is replaced by a slot number,
+// reused once the pointer is freed, so the replay needs no hash lookups.
+static void load_trace(const char* path, trace_t* trace) {
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror("Error opening file"); // Print error if file opening fails
+        exit(1);
+    }
+    size_t capacity = 1024;
+    trace->ops = malloc(capacity * sizeof(trace_op_t));
+    trace->num_ops = 0;
+    trace->num_slots = 0;
+    address_map_t map = {calloc(1024, sizeof(size_t)), malloc(1024 * sizeof(unsigned)), 1024, 0};
+    unsigned* free_slots = malloc(1024 * sizeof(unsigned));
+    size_t num_free_slots = 0, free_slots_capacity = 1024;
+    long realloc_slot = -1;             // Slot of the pending "<" line
+
+    char line[4096];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] != '@') continue;   // "= Start" and "= End" lines
+        const char* op = strstr(line, "] ");
+        if (op == NULL) op = strchr(line, ' ');  // No caller address given
+        if (op == NULL) continue;
+        while (*op == ']' || *op == ' ') op++;
+        char type = *op;
+        size_t address, size = 0;
+        const char* rest = parse_hex(op + 2, &address);
+        if (type == '+' || type == '>') parse_hex(rest + 1, &size);
+        if (address == 0) continue;     // Failed allocation or free(NULL)
+
+        if (trace->num_ops == capacity) {
+            capacity *= 2;
+            trace->ops = realloc(trace->ops, capacity * sizeof(trace_op_t));
+            if (trace->ops == NULL) {
+                perror("realloc failed");
+                exit(1);
+            }
+        }
+        trace_op_t* t = &trace->ops[trace->num_ops];
+        size_t i = address_map_find(&map, address);
+        if (type == '+' || (type == '>' && realloc_slot < 0)) {
+            // New pointer, a realloc of an unknown block counts as a malloc
+            unsigned slot = num_free_slots > 0 ? free_slots[--num_free_slots] : trace->num_slots++;
+            address_map_insert(&map, address, slot);
+            *t = (trace_op_t){'m', slot, size};
+        } else if (type == '>') {
+            address_map_insert(&map, address, (unsigned)realloc_slot);
+            *t = (trace_op_t){'r', (unsigned)realloc_slot, size};
+            realloc_slot = -1;
+        } else if ((type == '-' || type == '<') && map.addresses[i] != 0) {
+            unsigned slot = map.slots[i];
+            address_map_erase(&map, i);
+            if (type == '<') {
+                realloc_slot = slot;    // Completed by the next ">" line
+                continue;
+            }
+            if (num_free_slots == free_slots_capacity) {
+                free_slots_capacity *= 2;
+                free_slots = realloc(free_slots, free_slots_capacity * sizeof(unsigned));
+            }
+            free_slots[num_free_slots++] = slot;
+            *t = (trace_op_t){'f', slot, 0};
+        } else {
+            continue;                   // Block allocated before tracing started
+        }
+        trace->num_ops++;
+    }
+    fclose(fp);
+    free(map.addresses);
+    free(map.slots);
+    free(free_slots);
+}
+
+// Function to replay a loaded trace, returns the number of operations done
+static long run_trace(const allocator_t* a, const trace_t* trace) {
+    void** slots = calloc(trace->num_slots + 1, sizeof(void*));
+    for (size_t k = 0; k < trace->num_ops; k++) {
+        const trace_op_t* t = &trace->ops[k];
+        if (t->type == 'm') {
+            slots[t->slot] = a->alloc(t->size > 0 ? t->size : 1);
+            *(char*)slots[t->slot] = (char)k;
+        } else if (t->type == 'r') {
+            slots[t->slot] = a->resize(slots[t->slot], t->size > 0 ? t->size : 1);
+        } else {
+            a->release(slots[t->slot]);
+            slots[t->slot] = NULL;
+        }
+    }
+    for (unsigned s = 0; s < trace->num_slots; s++) {
+        if (slots[s] != NULL) a->release(slots[s]);  // Blocks the traced program never freed
+    }
+    free(slots);
+    return (long)trace->num_ops;
+}
+
+// Function to run one workload with one allocator in a child process
+// Prints the throughput and the peak resident set size of the child.
+static void run_child(const char* workload, const allocator_t* a, long operations, const trace_t* trace) {
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("pipe failed");
+        exit(1);
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork failed");
+        exit(1);
+    }
+    if (pid == 0) {
+        double start = now_seconds();
+        long done;
+        if (trace != NULL) done = run_trace(a, trace);
+        else if (strcmp(workload, "bursty") == 0) done = run_bursty(a, operations);
+        else if (strcmp(workload, "prodcons") == 0) done = run_prodcons(a, operations);
+        else done = run_lifetime(a, operations);
+        double rate = done / (now_seconds() - start);
+        if (write(fds[1], &rate, sizeof(rate)) != sizeof(rate)) _exit(1);
+        if (a->alloc == my_malloc) {
+            my_malloc_stats_print(stdout);  // State left behind by the workload
+        }
+        fflush(stdout);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    double rate = 0;
+    if (read(fds[0], &rate, sizeof(rate)) != sizeof(rate)) rate = 0;
+    close(fds[0]);
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    printf("%-24s %-10s %12.2f %12ld\n", workload, a->name, rate / 1e6, usage.ru_maxrss);
+}
+
+int main(int argc, char* argv[]) {
+    long operations = argc > 1 ? atol(argv[1]) : 10000000;
+    const allocator_t allocators[] = {
+        {"my_malloc", my_malloc, my_free, my_realloc},
+        {"malloc", malloc, free, realloc},
+    };
+    const char* synthetic[] = {"bursty", "prodcons", "lifetime"};
+
+    printf("%-24s %-10s %12s %12s\n", "workload", "allocator", "Mops/s", "peak RSS KB");
+    for (int w = 0; w < 3; w++) {
+        for (int a = 0; a < 2; a++) {
+            run_child(synthetic[w], &allocators[a], operations, NULL);
+        }
+    }
+    for (int f = 2; f < argc; f++) {
+        trace_t trace;
+        load_trace(argv[f], &trace);  // Loaded once, before forking, so both runs share it
+        for (int a = 0; a < 2; a++) {
+            run_child(argv[f], &allocators[a], 0, &trace);
+        }
+        free(trace.ops);
+    }
+    return 0;
+}
@@ -1,11 +1,31 @@
 // prod-cons.c
 // A Producer-Consumer Problem implementation with mutex locks and condition variables
+// Run with --spsc to use a lock-free single-producer/single-consumer ring instead, with
+// --mpmc P C for P producers and C consumers on a lock-free bounded queue, or with
+// --bench to measure the lock-free queues at several thread counts.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #define MAX 100  // Maximum buffer size
+#define SPSC_BATCH 32        // Items moved per put_n/get_n call in SPSC mode
+#define SPSC_SPIN_LIMIT 1000 // Checks before a blocked side sleeps on its futex
+#define CACHE_LINE 64
+#define MPMC_SIZE 128        // Slots of the MPMC queue, a power of two
+#define MPMC_MAX_THREADS 64  // Most producers or consumers in MPMC mode
+#define BENCH_ITEMS 4000000  // Items passed per benchmark run by default
+#define OUTPUT_BUFFER_SIZE 65536 // Bytes of log lines buffered before each write
+#define MAX_LINE_LENGTH (64 + (MAX + SPSC_BATCH) * 11) // Longest log line: every buffered value and a comma
 
 // Shared buffer and related variables
 __uint32_t buffer[MAX];
@@ -28,20 +48,66 @@ void put(__uint32_t value) {
     count++;                     // Increment buffer item count
 }
 
-// Opens the input file for the producer.
-FILE *open_input_file() {
-    FILE *input_file = fopen("input-part1.txt", "r");
-    if (!input_file) {
+// Input file mapped into memory and parsed in place
+typedef struct {
+    const char *data;       // Contents of the file
+    size_t length;          // Bytes in the file
+    size_t pos;             // Next byte to parse
+} input_reader_t;
+
+// Opens and maps the input file for the producer.
+void open_input_file(input_reader_t *input) {
+    int fd = open("input-part1.txt", O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
         perror("Error opening input file");
         exit(1);
     }
-    return input_file;
+    input->data = NULL;
+    input->length = st.st_size;
+    input->pos = 0;
+    if (input->length > 0) {
+        void *map = mmap(NULL, input->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("Error mapping input file");
+            exit(1);
+        }
+        madvise(map, input->length, MADV_SEQUENTIAL);
+        input->data = map;
+    }
+    close(fd);              // The mapping stays valid
+}
+
+// Reads the next unsigned decimal value, like fscanf("%u"). Returns 0 at the end of
+// the input or at anything that is not a number.
+int read_value(input_reader_t *input, __uint32_t *value) {
+    while (input->pos < input->length && (input->data[input->pos] == ' ' ||
+           (unsigned)(input->data[input->pos] - '\t') <= '\r' - '\t')) {
+        input->pos++;       // Skip whitespace
+    }
+    if (input->pos < input->length && input->data[input->pos] == '+') input->pos++;
+    if (input->pos == input->length || (unsigned)(input->data[input->pos] - '0') > 9) {
+        return 0;
+    }
+    __uint32_t v = 0;
+    while (input->pos < input->length && (unsigned)(input->data[input->pos] - '0') <= 9) {
+        v = v * 10 + (input->data[input->pos++] - '0');
+    }
+    *value = v;
+    return 1;
+}
+
+// Unmaps the input file.
+void close_input_file(input_reader_t *input) {
+    if (input->data != NULL) {
+        munmap((void *)input->data, input->length);
+    }
 }
 
 // Produces values from input file, placing them into the buffer. 
-void produce_values(FILE *input_file) {
+void produce_values(input_reader_t *input) {
     __uint32_t value;
-    while (fscanf(input_file, "%u", &value) == 1) {
+    while (read_value(input, &value) == 1) {
         pthread_mutex_lock(&mutex);  // Lock mutex for buffer access
 
         while (count == MAX) {       // Wait if buffer is full
@@ -71,35 +137,105 @@ __uint32_t get() {
     return tmp;
 }
 
-// Opens the output file for the consumer.
-FILE *open_output_file() {
-    FILE *output_file = fopen("output-part1.txt", "w");
-    if (!output_file) {
+// Buffered writer for the output file
+// Lines are formatted straight into the buffer, which is written out with one write(2)
+// when the next line might not fit. Writers of several threads may share a file: each
+// write holds whole lines, and Linux keeps concurrent writes to a file from mixing.
+typedef struct {
+    int fd;                 // Output file
+    size_t used;            // Bytes of buf not written yet
+    char buf[OUTPUT_BUFFER_SIZE];
+} output_writer_t;
+
+// Opens the output file for the consumer, returns its descriptor.
+int open_output_file() {
+    int fd = open("output-part1.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
         perror("Error opening output file");
         exit(1);
     }
-    return output_file;
+    return fd;
 }
 
-// Logs buffer state and consumed value to the output file.
-void log_buffer_state(FILE *output_file, __uint32_t value) {
-    fprintf(output_file, "Consumed:[%u],Buffer-State:[", value);
+// Starts buffering lines for an output file.
+void output_writer_init(output_writer_t *out, int fd) {
+    out->fd = fd;
+    out->used = 0;
+}
+
+// Writes out everything buffered so far.
+void output_writer_flush(output_writer_t *out) {
+    size_t done = 0;
+    while (done < out->used) {
+        ssize_t n = write(out->fd, out->buf + done, out->used - done);
+        if (n <= 0) {
+            perror("Error writing output file");
+            exit(1);
+        }
+        done += n;
+    }
+    out->used = 0;
+}
+
+// Makes room for a line of up to MAX_LINE_LENGTH bytes.
+void output_writer_begin_line(output_writer_t *out) {
+    if (out->used + MAX_LINE_LENGTH > sizeof(out->buf)) {
+        output_writer_flush(out);
+    }
+}
 
-    // Print buffer contents from 'use' to 'fill'
-    int i = use;
-    int c = count;
+// Appends a string; the line must have been begun.
+void output_write_str(output_writer_t *out, const char *s) {
+    size_t len = strlen(s);
+    memcpy(out->buf + out->used, s, len);
+    out->used += len;
+}
+
+// Appends an unsigned value in decimal; the line must have been begun.
+void output_write_u32(output_writer_t *out, __uint32_t value) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (n > 0) {
+        out->buf[out->used++] = digits[--n];
+    }
+}
+
+// Appends a consumed value and the buffer state after it, as one line.
+void output_write_state(output_writer_t *out, __uint32_t value, const __uint32_t *items, int c) {
+    output_writer_begin_line(out);
+    output_write_str(out, "Consumed:[");
+    output_write_u32(out, value);
+    output_write_str(out, "],Buffer-State:[");
     for (int j = 0; j < c; j++) {
-        int idx = (i + j) % MAX;
-        fprintf(output_file, "%u", buffer[idx]);
+        output_write_u32(out, items[j]);
         if (j < c - 1) {
-            fprintf(output_file, ",");
+            out->buf[out->used++] = ',';
         }
     }
-    fprintf(output_file, "]\n");
+    output_write_str(out, "]\n");
+}
+
+// Copies the buffer contents from 'use' to 'fill', returns how many; called with mutex held.
+int snapshot_buffer(__uint32_t *items) {
+    int first = MAX - use < count ? MAX - use : count;  // Items before the end of the array
+    memcpy(items, buffer + use, first * sizeof(__uint32_t));
+    memcpy(items + first, buffer, (count - first) * sizeof(__uint32_t));
+    return count;
+}
+
+// Logs buffer state and consumed value to the output file.
+// The state is a snapshot taken under the lock, so formatting happens without it.
+void log_buffer_state(output_writer_t *out, __uint32_t value, const __uint32_t *items, int c) {
+    output_write_state(out, value, items, c);
 }
 
 // Consumes values from the buffer and writes to output file.
-void consume_values(FILE *output_file) {
+void consume_values(output_writer_t *out) {
+    __uint32_t items[MAX];  // Buffer state after the consumed item
     while (1) {
         pthread_mutex_lock(&mutex); // Lock mutex for buffer access
 
@@ -113,18 +249,470 @@ void consume_values(FILE *output_file) {
         }
 
         __uint32_t tmp = get();         // Consume item from buffer
-        log_buffer_state(output_file, tmp); // Log buffer state and consumed item
+        int c = snapshot_buffer(items);   // Copy the buffer state, a few cache lines
         pthread_cond_signal(&empty_cond);      // Notify producer if buffer has space
-        pthread_mutex_unlock(&mutex);     // Unlock mutex after writing
+        pthread_mutex_unlock(&mutex);     // Unlock mutex before formatting
+        log_buffer_state(out, tmp, items, c); // Log buffer state and consumed item
     }
 }
 
+// LOCK-FREE SPSC RING
+// With one producer and one consumer the ring needs no lock: only the producer writes
+// head and only the consumer writes tail, each on its own cache line so they do not
+// bounce between the cores. Both count items since the start and index buffer modulo
+// MAX. A side that finds the ring full or empty spins briefly and then sleeps on a futex;
+// the other side only makes the wake-up system call when the waiting flag is set.
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_ulong head; // Items put so far, written by the producer
+    atomic_uint fill_seq;                   // Futex the consumer sleeps on while the ring is empty
+    atomic_int consumer_waiting;            // Set while the consumer may be asleep
+    atomic_int done;                        // Set once the producer has put its last item
+    _Alignas(CACHE_LINE) atomic_ulong tail; // Items taken so far, written by the consumer
+    atomic_uint space_seq;                  // Futex the producer sleeps on while the ring is full
+    atomic_int producer_waiting;            // Set while the producer may be asleep
+} spsc_ring_t;
+
+spsc_ring_t ring;
+
+// Sleeps until the futex word no longer holds expected or a wake-up arrives.
+static void futex_wait(atomic_uint *word, unsigned expected) {
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+// Wakes one thread sleeping on a futex word after bumping it, if any thread announced itself.
+// Waiters read the word before counting themselves, so a bump they missed makes their wait return.
+// The fence keeps the caller's publishing store from passing the check of waiting.
+static void futex_wake_waiter(atomic_uint *word, atomic_int *waiting) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(waiting)) {
+        atomic_fetch_add(word, 1);
+        syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+// Waits until ready() holds, spinning first and then sleeping on the futex word.
+// waiting counts the threads that may be asleep on the word.
+static void futex_wait_until(int (*ready)(void), atomic_uint *word, atomic_int *waiting) {
+    for (int spin = 0; spin < SPSC_SPIN_LIMIT; spin++) {
+        if (ready()) return;
+    }
+    while (!ready()) {
+        unsigned seq = atomic_load(word);
+        atomic_fetch_add(waiting, 1);
+        if (!ready()) {             // Checked again after the count is visible
+            futex_wait(word, seq);
+        }
+        atomic_fetch_sub(waiting, 1);
+    }
+}
+
+// Tells whether the ring has room for one more item (producer side).
+static int spsc_has_space(void) {
+    unsigned long head = atomic_load_explicit(&ring.head, memory_order_relaxed);
+    return head - atomic_load(&ring.tail) < MAX;
+}
+
+// Tells whether the ring holds an item or the producer is done (consumer side).
+static int spsc_has_items(void) {
+    unsigned long tail = atomic_load_explicit(&ring.tail, memory_order_relaxed);
+    return atomic_load(&ring.head) != tail || atomic_load(&ring.done);
+}
+
+// Adds n values to the ring, waiting for space as needed.
+void put_n(const __uint32_t *values, int n) {
+    while (n > 0) {
+        futex_wait_until(spsc_has_space, &ring.space_seq, &ring.producer_waiting);
+        unsigned long head = atomic_load_explicit(&ring.head, memory_order_relaxed);
+        unsigned long space = MAX - (head - atomic_load_explicit(&ring.tail, memory_order_acquire));
+        int k = n < (long)space ? n : (int)space;
+        for (int j = 0; j < k; j++) {
+            buffer[(head + j) % MAX] = values[j];
+        }
+        atomic_store(&ring.head, head + k);   // Publishes the items to the consumer
+        futex_wake_waiter(&ring.fill_seq, &ring.consumer_waiting);
+        values += k;
+        n -= k;
+    }
+}
+
+// Marks the end of production and wakes the consumer.
+void spsc_finish(void) {
+    atomic_store(&ring.done, 1);
+    futex_wake_waiter(&ring.fill_seq, &ring.consumer_waiting);
+}
+
+// Takes up to max values from the ring, waiting while it is empty.
+// Returns the number taken, 0 once the producer is done and the ring is drained.
+int get_n(__uint32_t *values, int max) {
+    futex_wait_until(spsc_has_items, &ring.fill_seq, &ring.consumer_waiting);
+    unsigned long tail = atomic_load_explicit(&ring.tail, memory_order_relaxed);
+    unsigned long available = atomic_load_explicit(&ring.head, memory_order_acquire) - tail;
+    int k = available < (unsigned long)max ? (int)available : max;
+    for (int j = 0; j < k; j++) {
+        values[j] = buffer[(tail + j) % MAX];
+    }
+    atomic_store(&ring.tail, tail + k);       // Hands the slots back to the producer
+    futex_wake_waiter(&ring.space_seq, &ring.producer_waiting);
+    return k;
+}
+
+// Produces values from input file in batches through the SPSC ring.
+void spsc_produce_values(input_reader_t *input) {
+    __uint32_t batch[SPSC_BATCH];
+    int n = 0;
+    __uint32_t value;
+    while (read_value(input, &value) == 1 && value != 0) {  // End production at zero
+        batch[n++] = value;
+        if (n == SPSC_BATCH) {
+            put_n(batch, n);
+            n = 0;
+        }
+    }
+    put_n(batch, n);
+    spsc_finish();
+}
+
+// Logs a consumed value with the rest of its batch and what the ring holds after it.
+void spsc_log_buffer_state(output_writer_t *out, const __uint32_t *batch, int remaining) {
+    __uint32_t items[SPSC_BATCH + MAX];
+    memcpy(items, batch + 1, remaining * sizeof(__uint32_t));
+    unsigned long tail = atomic_load_explicit(&ring.tail, memory_order_relaxed);
+    unsigned long head = atomic_load_explicit(&ring.head, memory_order_acquire);
+    int c = remaining;
+    for (unsigned long pos = tail; pos < head; pos++) {
+        items[c++] = buffer[pos % MAX];  // Not consumed yet, so the producer leaves them alone
+    }
+    output_write_state(out, batch[0], items, c);
+}
+
+// Consumes values in batches from the SPSC ring and writes to output file.
+void spsc_consume_values(output_writer_t *out) {
+    __uint32_t batch[SPSC_BATCH];
+    int n;
+    while ((n = get_n(batch, SPSC_BATCH)) > 0) {
+        for (int j = 0; j < n; j++) {
+            spsc_log_buffer_state(out, batch + j, n - 1 - j);
+        }
+    }
+}
+
+
+// LOCK-FREE BOUNDED MPMC QUEUE
+// Vyukov's bounded queue: every slot carries a sequence number telling whose turn it is.
+// A producer claims the slot at enqueue_pos when its sequence equals the position, and
+// publishes the value by setting it to position + 1; a consumer claims it at that value
+// and hands it back for the next lap with position + MPMC_SIZE. Claiming is one
+// compare-and-swap on the position, so producers and consumers only contend among
+// themselves. Threads that find the queue full or empty wait as in the SPSC ring.
+typedef struct {
+    atomic_ulong seq;       // Turn of the slot, see above
+    __uint32_t value;
+} mpmc_cell_t;
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_ulong enqueue_pos; // Next position producers claim
+    _Alignas(CACHE_LINE) atomic_ulong dequeue_pos; // Next position consumers claim
+    _Alignas(CACHE_LINE) atomic_uint fill_seq;     // Futex consumers sleep on while the queue is empty
+    atomic_int consumers_waiting;                  // Consumers that may be asleep
+    _Alignas(CACHE_LINE) atomic_uint space_seq;    // Futex producers sleep on while the queue is full
+    atomic_int producers_waiting;                  // Producers that may be asleep
+    _Alignas(CACHE_LINE) mpmc_cell_t cells[MPMC_SIZE];
+    atomic_int producers_left;                     // Producers that have not finished yet
+    int num_consumers;
+} mpmc_queue_t;
+
+mpmc_queue_t queue;
+
+// Empties the queue for a run with the given numbers of threads.
+void mpmc_init(int num_producers, int num_consumers) {
+    atomic_store(&queue.enqueue_pos, 0);
+    atomic_store(&queue.dequeue_pos, 0);
+    atomic_store(&queue.consumers_waiting, 0);
+    atomic_store(&queue.producers_waiting, 0);
+    for (int i = 0; i < MPMC_SIZE; i++) {
+        atomic_store(&queue.cells[i].seq, i);
+    }
+    atomic_store(&queue.producers_left, num_producers);
+    queue.num_consumers = num_consumers;
+}
+
+// Tries to add a value, returns 0 if the queue is full.
+static int mpmc_try_put(__uint32_t value) {
+    unsigned long pos = atomic_load_explicit(&queue.enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        mpmc_cell_t *cell = &queue.cells[pos & (MPMC_SIZE - 1)];
+        long dif = (long)(atomic_load_explicit(&cell->seq, memory_order_acquire) - pos);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue.enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->value = value;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0;               // The slot still holds a value from the previous lap
+        } else {
+            pos = atomic_load_explicit(&queue.enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Tries to take a value, returns 0 if the queue is empty.
+static int mpmc_try_get(__uint32_t *value) {
+    unsigned long pos = atomic_load_explicit(&queue.dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        mpmc_cell_t *cell = &queue.cells[pos & (MPMC_SIZE - 1)];
+        long dif = (long)(atomic_load_explicit(&cell->seq, memory_order_acquire) - (pos + 1));
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue.dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *value = cell->value;
+                atomic_store_explicit(&cell->seq, pos + MPMC_SIZE, memory_order_release);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0;               // Nothing published in the slot yet
+        } else {
+            pos = atomic_load_explicit(&queue.dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Tells whether the next slot producers claim looks free.
+static int mpmc_has_space(void) {
+    unsigned long pos = atomic_load(&queue.enqueue_pos);
+    return atomic_load(&queue.cells[pos & (MPMC_SIZE - 1)].seq) == pos;
+}
+
+// Tells whether the next slot consumers claim looks filled.
+static int mpmc_has_items(void) {
+    unsigned long pos = atomic_load(&queue.dequeue_pos);
+    return atomic_load(&queue.cells[pos & (MPMC_SIZE - 1)].seq) == pos + 1;
+}
+
+// Adds a value to the queue, waiting while it is full.
+void mpmc_put(__uint32_t value) {
+    while (!mpmc_try_put(value)) {
+        futex_wait_until(mpmc_has_space, &queue.space_seq, &queue.producers_waiting);
+    }
+    futex_wake_waiter(&queue.fill_seq, &queue.consumers_waiting);
+}
+
+// Takes a value from the queue, waiting while it is empty.
+__uint32_t mpmc_get(void) {
+    __uint32_t value;
+    while (!mpmc_try_get(&value)) {
+        futex_wait_until(mpmc_has_items, &queue.fill_seq, &queue.consumers_waiting);
+    }
+    futex_wake_waiter(&queue.space_seq, &queue.producers_waiting);
+    return value;
+}
+
+// Called by each producer once it is done; the last one tells every consumer to stop.
+// Input values are never 0, so a 0 in the queue is the stop signal of one consumer.
+void mpmc_producer_finished(void) {
+    if (atomic_fetch_sub(&queue.producers_left, 1) == 1) {
+        for (int i = 0; i < queue.num_consumers; i++) {
+            mpmc_put(0);
+        }
+    }
+}
+
+// Shared input of the MPMC producers
+input_reader_t mpmc_input;
+pthread_mutex_t mpmc_input_mutex = PTHREAD_MUTEX_INITIALIZER;
+int mpmc_input_ended = 0;   // Set, under mpmc_input_mutex, once a 0 or the end of the file is read
+
+// Reads up to max values from the shared input, returns how many were read.
+// The batch is read under mpmc_input_mutex, so producers take turns on the file.
+int mpmc_read_batch(__uint32_t *values, int max) {
+    int n = 0;
+    pthread_mutex_lock(&mpmc_input_mutex);
+    while (n < max && !mpmc_input_ended) {
+        if (read_value(&mpmc_input, &values[n]) != 1 || values[n] == 0) {
+            mpmc_input_ended = 1;   // End production if value is zero
+        } else {
+            n++;
+        }
+    }
+    pthread_mutex_unlock(&mpmc_input_mutex);
+    return n;
+}
+
+// MPMC producer thread: moves batches of input values into the queue.
+void *mpmc_producer(void *arg) {
+    __uint32_t batch[SPSC_BATCH];
+    int n;
+    while ((n = mpmc_read_batch(batch, SPSC_BATCH)) > 0) {
+        for (int j = 0; j < n; j++) {
+            mpmc_put(batch[j]);
+        }
+    }
+    mpmc_producer_finished();
+    return NULL;
+}
+
+// MPMC consumer thread: logs every value it takes from the queue.
+// Consumers share the output file and write whole lines; there is no consistent buffer
+// state to print without a lock, so only the consumed value is logged.
+void *mpmc_consumer(void *arg) {
+    output_writer_t *out = malloc(sizeof(output_writer_t));
+    if (out == NULL) {
+        perror("malloc failed");
+        exit(1);
+    }
+    output_writer_init(out, *(int *)arg);
+    __uint32_t value;
+    while ((value = mpmc_get()) != 0) {
+        output_writer_begin_line(out);
+        output_write_str(out, "Consumed:[");
+        output_write_u32(out, value);
+        output_write_str(out, "]\n");
+    }
+    output_writer_flush(out);
+    free(out);
+    return NULL;
+}
+
+// Runs P producers and C consumers on the MPMC queue over the input and output files.
+void run_mpmc(int num_producers, int num_consumers) {
+    pthread_t threads[2 * MPMC_MAX_THREADS];
+    open_input_file(&mpmc_input);
+    int output_fd = open_output_file();
+    mpmc_init(num_producers, num_consumers);
+    for (int i = 0; i < num_producers; i++) {
+        pthread_create(&threads[i], NULL, mpmc_producer, NULL);
+    }
+    for (int i = 0; i < num_consumers; i++) {
+        pthread_create(&threads[num_producers + i], NULL, mpmc_consumer, &output_fd);
+    }
+    for (int i = 0; i < num_producers + num_consumers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    close(output_fd);
+    close_input_file(&mpmc_input);
+}
+
+
+// BENCHMARK
+// Moves synthetic values through the lock-free queues, without files, and prints the
+// throughput for each number of producers and consumers.
+long bench_items_per_producer;
+atomic_ulong bench_sum;     // Sum of the values consumed, checked after each run
+
+// Returns the time of the monotonic clock in seconds.
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Benchmark producer on the MPMC queue.
+void *bench_mpmc_producer(void *arg) {
+    for (long i = 1; i <= bench_items_per_producer; i++) {
+        mpmc_put((__uint32_t)i);
+    }
+    mpmc_producer_finished();
+    return NULL;
+}
+
+// Benchmark consumer on the MPMC queue.
+void *bench_mpmc_consumer(void *arg) {
+    unsigned long sum = 0;
+    __uint32_t value;
+    while ((value = mpmc_get()) != 0) {
+        sum += value;
+    }
+    atomic_fetch_add(&bench_sum, sum);
+    return NULL;
+}
+
+// Benchmark producer on the SPSC ring.
+void *bench_spsc_producer(void *arg) {
+    __uint32_t batch[SPSC_BATCH];
+    int n = 0;
+    for (long i = 1; i <= bench_items_per_producer; i++) {
+        batch[n++] = (__uint32_t)i;
+        if (n == SPSC_BATCH) {
+            put_n(batch, n);
+            n = 0;
+        }
+    }
+    put_n(batch, n);
+    spsc_finish();
+    return NULL;
+}
+
+// Benchmark consumer on the SPSC ring.
+void *bench_spsc_consumer(void *arg) {
+    __uint32_t batch[SPSC_BATCH];
+    unsigned long sum = 0;
+    int n;
+    while ((n = get_n(batch, SPSC_BATCH)) > 0) {
+        for (int j = 0; j < n; j++) {
+            sum += batch[j];
+        }
+    }
+    atomic_fetch_add(&bench_sum, sum);
+    return NULL;
+}
+
+// Runs one benchmark configuration and prints its throughput.
+void bench_run(const char *mode, int num_producers, int num_consumers, long items) {
+    pthread_t threads[2 * MPMC_MAX_THREADS];
+    int spsc = strcmp(mode, "spsc") == 0;
+    bench_items_per_producer = items / num_producers;
+    atomic_store(&bench_sum, 0);
+    if (spsc) {
+        memset(&ring, 0, sizeof(ring));
+    } else {
+        mpmc_init(num_producers, num_consumers);
+    }
+
+    double start = now_seconds();
+    for (int i = 0; i < num_producers; i++) {
+        pthread_create(&threads[i], NULL, spsc ? bench_spsc_producer : bench_mpmc_producer, NULL);
+    }
+    for (int i = 0; i < num_consumers; i++) {
+        pthread_create(&threads[num_producers + i], NULL, spsc ? bench_spsc_consumer : bench_mpmc_consumer, NULL);
+    }
+    for (int i = 0; i < num_producers + num_consumers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    unsigned long n = bench_items_per_producer;
+    unsigned long expected = num_producers * (n * (n + 1) / 2);
+    long total = bench_items_per_producer * num_producers;
+    printf("%-6s %9d %9d %12.2f%s\n", mode, num_producers, num_consumers, total / elapsed / 1e6,
+           atomic_load(&bench_sum) == expected ? "" : "  (wrong sum)");
+    fflush(stdout);
+}
+
+// Runs the benchmark at 1 to 8 producers and consumers.
+void run_bench(long items) {
+    printf("%-6s %9s %9s %12s\n", "queue", "producers", "consumers", "Mitems/s");
+    bench_run("spsc", 1, 1, items);
+    for (int p = 1; p <= 8; p *= 2) {
+        for (int c = 1; c <= 8; c *= 2) {
+            bench_run("mpmc", p, c, items);
+        }
+    }
+}
+
+int use_spsc = 0;           // Set by --spsc
+
 // MAIN PRODUCER FUNCTION
 // Producer thread function to produce values.
 void *producer(void *arg) {
-    FILE *input_file = open_input_file(); // Open input file
-    produce_values(input_file);           // Produce values
-    fclose(input_file);                   // Close the input file
+    input_reader_t input;
+    open_input_file(&input);              // Open input file
+    if (use_spsc) {
+        spsc_produce_values(&input);      // Produce values through the lock-free ring
+    } else {
+        produce_values(&input);           // Produce values
+    }
+    close_input_file(&input);             // Close the input file
     return NULL;
 }
 
@@ -132,18 +720,46 @@ void *producer(void *arg) {
 // MAIN CONSUMER FUNCTION
 // Consumer thread function to consume values and log buffer state.
 void *consumer(void *arg) {
-    FILE *output_file = open_output_file(); // Open output file
-    consume_values(output_file);            // Consume values
-    fclose(output_file);                    // Close the output file
+    output_writer_t *out = malloc(sizeof(output_writer_t));
+    if (out == NULL) {
+        perror("malloc failed");
+        exit(1);
+    }
+    output_writer_init(out, open_output_file()); // Open output file
+    if (use_spsc) {
+        spsc_consume_values(out);           // Consume values from the lock-free ring
+    } else {
+        consume_values(out);                // Consume values
+    }
+    output_writer_flush(out);
+    close(out->fd);                         // Close the output file
+    free(out);
     return NULL;
 }
 
 
 // MAIN FUNCTION
 // Main function to initialize and join producer and consumer threads.
-int main() {
+// Usage: ./prod-cons [--spsc | --mpmc P C | --bench [items]]
+int main(int argc, char *argv[]) {
     pthread_t p, c; // Thread identifiers
 
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_bench(argc > 2 ? atol(argv[2]) : BENCH_ITEMS);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--mpmc") == 0) {
+        int num_producers = argc > 2 ? atoi(argv[2]) : 2;
+        int num_consumers = argc > 3 ? atoi(argv[3]) : 2;
+        if (num_producers < 1 || num_consumers < 1 || num_producers > MPMC_MAX_THREADS || num_consumers > MPMC_MAX_THREADS) {
+            fprintf(stderr, "Producers and consumers must be between 1 and %d\n", MPMC_MAX_THREADS);
+            exit(1);
+        }
+        run_mpmc(num_producers, num_consumers);
+        return 0;
+    }
+    use_spsc = argc > 1 && strcmp(argv[1], "--spsc") == 0;
+
     // Create producer and consumer threads
     pthread_create(&p, NULL, producer, NULL);
     pthread_create(&c, NULL, consumer, NULL);
@@ -0,0 +1,206 @@
+// rwlock-bench.h
+// Steady-state benchmark of a reader-writer lock, shared by the rwlock programs
+// Usage: ./rwlock-... --bench [threads] [seconds] [read-percent] [cs-iterations]
+//
+// A fixed pool of threads (4 by default) runs for a set time (2 seconds). Each operation
+// is a read with the given probability (90%) and a write otherwise, and holds the lock
+// for perform_read or perform_write on the shared file plus a busy loop of cs-iterations
+// (100). The time to acquire the lock is recorded in a log-linear histogram per thread,
+// so recording costs no shared memory traffic. The report gives operations per second and
+// the p50/p99/p999 acquire latency of reads and writes; each percentile is the lower
+// bound of its bucket, within 12.5% of the true value.
+//
+// Include after the lock functions: the harness uses rwlock, shared_fd, perform_read,
+// perform_write and the rwlock_acquire/release functions of the including file.
+
+#ifndef RWLOCK_BENCH_H
+#define RWLOCK_BENCH_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+#define BENCH_FILE "rwlock-bench-file.txt" // Scratch file standing in for the shared file
+#define BENCH_FILE_SIZE 4096               // Bytes the scratch file starts with
+#define HIST_BUCKETS 496                   // 16 exact buckets, then 8 per power of two
+
+// Settings of a benchmark run
+typedef struct {
+    int threads;        // Threads in the pool
+    double seconds;     // Length of the run
+    int read_percent;   // Share of operations that read
+    int cs_iterations;  // Busy work inside the lock on top of the file access
+} bench_config_t;
+
+// Counts and acquire latencies of one benchmark thread
+typedef struct {
+    long ops;                          // Operations completed
+    uint64_t read_hist[HIST_BUCKETS];  // Read acquire latencies in nanoseconds
+    uint64_t write_hist[HIST_BUCKETS]; // Write acquire latencies in nanoseconds
+    unsigned seed;                     // Random state for the read/write choice
+} bench_thread_t;
+
+const bench_config_t *bench_config;    // Settings of the current run
+atomic_int bench_stop;                 // Set when the run time is over
+pthread_barrier_t bench_start;         // Starts the pool and the clock together
+
+// Function to parse the benchmark arguments, keeping the defaults for those left out
+bench_config_t parse_bench_args(int argc, char **argv) {
+    bench_config_t config = {4, 2.0, 90, 100};
+    if (argc > 0) config.threads = atoi(argv[0]);
+    if (argc > 1) config.seconds = atof(argv[1]);
+    if (argc > 2) config.read_percent = atoi(argv[2]);
+    if (argc > 3) config.cs_iterations = atoi(argv[3]);
+    if (config.threads < 1 || config.seconds <= 0 || config.read_percent < 0 ||
+        config.read_percent > 100 || config.cs_iterations < 0) {
+        fprintf(stderr, "Usage: --bench [threads] [seconds] [read-percent] [cs-iterations]\n");
+        exit(EXIT_FAILURE);
+    }
+    return config;
+}
+
+// Function to get the time of the monotonic clock in nanoseconds
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Function to find the histogram bucket of a latency
+static int hist_bucket(uint64_t ns) {
+    if (ns < 16) return (int)ns;
+    int exponent = 63 - __builtin_clzll(ns);              // At least 4
+    return 16 + (exponent - 4) * 8 + (int)((ns >> (exponent - 3)) & 7);
+}
+
+// Function to get the smallest latency that falls in a bucket
+static uint64_t hist_bucket_floor(int bucket) {
+    if (bucket < 16) return bucket;
+    int exponent = (bucket - 16) / 8 + 4;
+    return (uint64_t)(8 + (bucket - 16) % 8) << (exponent - 3);
+}
+
+// Function to find a percentile of a histogram, returns 0 when it is empty
+static uint64_t hist_percentile(const uint64_t *hist, double percentile) {
+    uint64_t total = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) total += hist[b];
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(percentile / 100 * (total - 1)); // Samples below the percentile
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen > rank) return hist_bucket_floor(b);
+    }
+    return hist_bucket_floor(HIST_BUCKETS - 1);
+}
+
+// Function to do busy work inside the lock
+static void bench_spin(int iterations) {
+    for (volatile int i = 0; i < iterations; i++) {
+    }
+}
+
+// Function to run operations on one benchmark thread until the run is over
+static void *bench_worker(void *arg) {
+    bench_thread_t *t = (bench_thread_t *)arg;
+    pthread_barrier_wait(&bench_start);
+    while (!atomic_load_explicit(&bench_stop, memory_order_relaxed)) {
+        t->seed ^= t->seed << 13;
+        t->seed ^= t->seed >> 17;
+        t->seed ^= t->seed << 5;
+        int is_read = (int)(t->seed % 100) < bench_config->read_percent;
+        uint64_t start = bench_now_ns();
+        if (is_read) {
+            rwlock_acquire_readlock(&rwlock);
+            t->read_hist[hist_bucket(bench_now_ns() - start)]++;
+            perform_read();
+            bench_spin(bench_config->cs_iterations);
+            rwlock_release_readlock(&rwlock);
+        } else {
+            rwlock_acquire_writelock(&rwlock);
+            t->write_hist[hist_bucket(bench_now_ns() - start)]++;
+            perform_write();
+            bench_spin(bench_config->cs_iterations);
+            rwlock_release_writelock(&rwlock);
+        }
+        t->ops++;
+    }
+    return NULL;
+}
+
+// Function to benchmark the initialized rwlock and print one line of results
+// The shared file is swapped for a scratch file so the runs do not grow shared-file.txt.
+void run_rwlock_bench(const char *variant, const bench_config_t *config) {
+    static int header_printed;
+    if (!header_printed) {
+        header_printed = 1;
+        printf("%d threads, %.1f s, %d%% reads, %d cs iterations; acquire latency in ns\n",
+               config->threads, config->seconds, config->read_percent, config->cs_iterations);
+        printf("%-12s %12s %8s %8s %8s %8s %8s %8s\n", "variant", "ops/s",
+               "rd-p50", "rd-p99", "rd-p999", "wr-p50", "wr-p99", "wr-p999");
+    }
+
+    int saved_fd = shared_fd;
+    shared_fd = open(BENCH_FILE, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (shared_fd == -1) {
+        perror("Failed to open benchmark file");
+        exit(EXIT_FAILURE);
+    }
+    char fill[BENCH_FILE_SIZE];
+    memset(fill, 'x', sizeof(fill));
+    if (write(shared_fd, fill, sizeof(fill)) != (ssize_t)sizeof(fill)) {
+        perror("Failed to fill benchmark file");
+        exit(EXIT_FAILURE);
+    }
+
+    bench_thread_t *threads = calloc(config->threads, sizeof(bench_thread_t));
+    pthread_t *ids = malloc(config->threads * sizeof(pthread_t));
+    if (threads == NULL || ids == NULL) {
+        perror("malloc failed");
+        exit(EXIT_FAILURE);
+    }
+    bench_config = config;
+    atomic_store(&bench_stop, 0);
+    pthread_barrier_init(&bench_start, NULL, config->threads + 1);
+    for (int i = 0; i < config->threads; i++) {
+        threads[i].seed = 2463534242u + i;
+        pthread_create(&ids[i], NULL, bench_worker, &threads[i]);
+    }
+
+    pthread_barrier_wait(&bench_start);
+    uint64_t start = bench_now_ns();
+    struct timespec duration = {(time_t)config->seconds,
+                                (long)((config->seconds - (time_t)config->seconds) * 1e9)};
+    nanosleep(&duration, NULL);
+    atomic_store(&bench_stop, 1);
+    for (int i = 0; i < config->threads; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    double elapsed = (bench_now_ns() - start) / 1e9;
+    pthread_barrier_destroy(&bench_start);
+
+    // Merge the per-thread results into the first thread's
+    for (int i = 1; i < config->threads; i++) {
+        threads[0].ops += threads[i].ops;
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            threads[0].read_hist[b] += threads[i].read_hist[b];
+            threads[0].write_hist[b] += threads[i].write_hist[b];
+        }
+    }
+    printf("%-12s %12.0f %8lu %8lu %8lu %8lu %8lu %8lu\n", variant, threads[0].ops / elapsed,
+           (unsigned long)hist_percentile(threads[0].read_hist, 50),
+           (unsigned long)hist_percentile(threads[0].read_hist, 99),
+           (unsigned long)hist_percentile(threads[0].read_hist, 99.9),
+           (unsigned long)hist_percentile(threads[0].write_hist, 50),
+           (unsigned long)hist_percentile(threads[0].write_hist, 99),
+           (unsigned long)hist_percentile(threads[0].write_hist, 99.9));
+    fflush(stdout);
+
+    free(ids);
+    free(threads);
+    close(shared_fd);
+    unlink(BENCH_FILE);
+    shared_fd = saved_fd;
+}
+
+#endif
@@ -1,11 +1,15 @@
 // rwlock-reader-pref.c
 // A Reader-Writer Lock with Reader Preference implementation
+// Run with --bench to measure steady-state throughput and acquire latency (see rwlock-bench.h)
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 // Define the Reader-Writer lock structure
 typedef struct _rwlock_t {
@@ -17,11 +21,21 @@ typedef struct _rwlock_t {
 // Global variables
 rwlock_t rwlock;      // Reader-writer lock instance
 FILE *output_file;    // File pointer for output logging
+int shared_fd = -1;    // Shared file, held open for every operation
 sem_t output_lock;    // Semaphore to control access to the output file
 
 
 //INITIALISATION FUNCTION
-// Initialize the reader-writer lock and output file
+// Open the shared file for reading and appending, keeping it open for the whole run
+void open_shared_file() {
+    shared_fd = open("shared-file.txt", O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (shared_fd == -1) {
+        perror("Failed to open shared file");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Initialize the reader-writer lock and shared file
 void initialize_rwlock(rwlock_t *rw) {
     // Initialize the reader count to zero
     rw->readers = 0;
@@ -33,7 +47,13 @@ void initialize_rwlock(rwlock_t *rw) {
     // Initialize the output file lock
     sem_init(&output_lock, 0, 1);
 
-    // Open the output file to log activities
+
+    // Open the shared file once; every read and write goes through this descriptor
+    open_shared_file();
+}
+
+// Open the output file to log activities
+void open_output_file() {
     output_file = fopen("output-reader-pref.txt", "w");
     if (output_file == NULL) {
         perror("Failed to open output file");  // Print error message if file opening fails
@@ -54,11 +74,10 @@ void log_reader_activity(int num_readers) {
 
 // Reader operation: reads the shared file
 void perform_read() {
-    // Open the shared file to read contents (simulating the read operation)
-    FILE *shared_file = fopen("shared-file.txt", "r");
-    if (shared_file != NULL) {
-        // Perform a read operation (e.g., read contents here, if needed)
-        fclose(shared_file);  // Close file after reading
+    // Read the start of the shared file through the open descriptor
+    char contents[256];
+    if (pread(shared_fd, contents, sizeof(contents), 0) < 0) {
+        perror("Failed to read shared file");
     }
 }
 
@@ -101,11 +120,10 @@ void log_writer_activity(int num_readers) {
 
 // Writer operation: writes to the shared file
 void perform_write() {
-    // Open the shared file to append contents (simulating the write operation)
-    FILE *shared_file = fopen("shared-file.txt", "a");
-    if (shared_file != NULL) {
-        fprintf(shared_file, "Hello world!\n");  // Append a line to the shared file
-        fclose(shared_file);                     // Close file after writing
+    // Append a line to the shared file; O_APPEND puts it at the end
+    static const char line[] = "Hello world!\n";
+    if (write(shared_fd, line, sizeof(line) - 1) < 0) {
+        perror("Failed to write shared file");
     }
 }
 
@@ -122,6 +140,10 @@ void rwlock_release_writelock(rwlock_t *rw) {
 }
 
 
+// Benchmark harness, built on the lock and file functions above
+#include "rwlock-bench.h"
+
+
 //MAIN READER FUNCTION
 // Reader thread function
 void *reader(void *arg) {
@@ -176,12 +198,22 @@ void *writer(void *arg) {
 
 // Main function
 int main(int argc, char **argv) {
+    // Benchmark the lock instead with --bench [threads] [seconds] [read-percent] [cs-iterations]
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        bench_config_t config = parse_bench_args(argc - 2, argv + 2);
+        initialize_rwlock(&rwlock);
+        run_rwlock_bench("reader-pref", &config);
+        close(shared_fd);
+        return 0;
+    }
+
     if (argc != 3) return 1;
     int n = atoi(argv[1]);
     int m = atoi(argv[2]);
 
     // Perform initialization of locks, files, and other resources
     initialize_rwlock(&rwlock);
+    open_output_file();
 
     pthread_t readers[n], writers[m];
 
@@ -195,5 +227,6 @@ int main(int argc, char **argv) {
 
     // Close the output file after all operations are complete
     fclose(output_file);
+    close(shared_fd);
     return 0;
 }
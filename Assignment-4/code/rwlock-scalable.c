@@ -0,0 +1,358 @@
+// rwlock-scalable.c
+// A Reader-Writer Lock built on futexes with per-CPU reader counters
+// Usage: ./rwlock-scalable n m [reader|writer|phase-fair]   (writer preference by default)
+//        ./rwlock-scalable --bench [threads] [seconds] [read-percent] [cs-iterations]
+//
+// Readers never touch a shared cache line on the fast path: each one counts itself on the
+// cache line of its CPU and then checks that no writer has flagged the lock. A writer
+// raises the flag and then scans every counter until the readers have drained, so only
+// writers pay for the number of CPUs. Both sides use sequentially consistent atomics, so
+// either the reader sees the flag and backs off or the writer sees the reader's count.
+// Readers that back off sleep on the flag word; the waking writer only makes the system
+// call when one of them announced itself.
+//
+// The policy decides who goes first when both sides wait:
+//   reader     - a writer raises the flag only once no reader holds the lock, and lowers
+//                it again if a reader slipped in, so waiting writers never hold up readers
+//   writer     - the flag counts waiting writers, so new readers wait until every
+//                writer is done
+//   phase-fair - one writer at a time raises the flag, and the next writer first waits
+//                for the readers blocked by the previous one to get in, so reader and
+//                writer phases alternate
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define CACHE_LINE 64
+#define RW_SLOTS 64     // Reader counters; CPUs beyond this share one
+
+// Which side a contended lock favours
+typedef enum {
+    RW_READER_PREF,
+    RW_WRITER_PREF,
+    RW_PHASE_FAIR,
+} rw_policy_t;
+
+// Counter of the readers holding the lock from one CPU, alone on its cache line
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_long readers;
+} rw_slot_t;
+
+// Define the Reader-Writer lock structure
+typedef struct _rwlock_t {
+    rw_slot_t slots[RW_SLOTS];      // Readers holding the lock, per CPU
+    _Alignas(CACHE_LINE) atomic_uint wflag; // Nonzero while readers must wait; futex they sleep on
+    atomic_uint blocked;            // Readers that backed off and have not got in yet
+    atomic_uint drain_seq;          // Futex the writer sleeps on until the readers drain
+    atomic_int drain_waiting;       // Set while the writer may be asleep on drain_seq
+    pthread_mutex_t writelock;      // One writer at a time
+    rw_policy_t policy;
+} rwlock_t;
+
+// Global variables
+rwlock_t rwlock;      // Reader-writer lock instance
+FILE *output_file;    // File pointer for output logging
+int shared_fd = -1;   // Shared file, held open for every operation
+pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER; // Controls access to the output file
+__thread int reader_slot = -1; // Counter this thread uses, picked from its CPU on first use
+
+
+//FUTEX HELPERS
+// Sleeps until the futex word no longer holds expected or a wake-up arrives.
+static void futex_wait(atomic_uint *word, unsigned expected) {
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+// Wakes up to count threads sleeping on the futex word.
+static void futex_wake(atomic_uint *word, int count) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+
+//INITIALISATION FUNCTION
+// Open the shared file for reading and appending, keeping it open for the whole run
+void open_shared_file() {
+    shared_fd = open("shared-file.txt", O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (shared_fd == -1) {
+        perror("Failed to open shared file");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Initialize the reader-writer lock and shared file
+void initialize_rwlock(rwlock_t *rw, rw_policy_t policy) {
+    for (int i = 0; i < RW_SLOTS; i++) {
+        atomic_init(&rw->slots[i].readers, 0);
+    }
+    atomic_init(&rw->wflag, 0);
+    atomic_init(&rw->blocked, 0);
+    atomic_init(&rw->drain_seq, 0);
+    atomic_init(&rw->drain_waiting, 0);
+    pthread_mutex_init(&rw->writelock, NULL);
+    rw->policy = policy;
+
+    // Open the shared file once; every read and write goes through this descriptor
+    open_shared_file();
+}
+
+// Open the output file to log activities
+void open_output_file() {
+    output_file = fopen("output-scalable.txt", "w");
+    if (output_file == NULL) {
+        perror("Failed to open output file");  // Print error message if file opening fails
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Counts the readers holding the lock by scanning every CPU's counter.
+// Readers that are backing off may still be counted for a moment.
+long rwlock_count_readers(rwlock_t *rw) {
+    long total = 0;
+    for (int i = 0; i < RW_SLOTS; i++) {
+        total += atomic_load(&rw->slots[i].readers);
+    }
+    return total;
+}
+
+
+//READER HELPER FUNCTIONS
+// Log reader activity to the output file
+void log_reader_activity(long num_readers) {
+    // Write to output file with synchronized access
+    pthread_mutex_lock(&output_lock);
+    fprintf(output_file, "Reading,Number-of-readers-present:[%ld]\n", num_readers);
+    fflush(output_file);
+    pthread_mutex_unlock(&output_lock);
+}
+
+// Reader operation: reads the shared file
+void perform_read() {
+    // Read the start of the shared file through the open descriptor
+    char contents[256];
+    if (pread(shared_fd, contents, sizeof(contents), 0) < 0) {
+        perror("Failed to read shared file");
+    }
+}
+
+// Wakes the writer waiting for the readers to drain, if it is asleep.
+// Only the reader that clears drain_waiting makes the system call; the writer sets it
+// again before it next sleeps.
+static void rwlock_wake_drain(rwlock_t *rw) {
+    if (atomic_load(&rw->drain_waiting) && atomic_exchange(&rw->drain_waiting, 0)) {
+        atomic_fetch_add(&rw->drain_seq, 1);
+        futex_wake(&rw->drain_seq, 1);
+    }
+}
+
+// Acquire the read lock for readers
+void rwlock_acquire_readlock(rwlock_t *rw) {
+    if (reader_slot < 0) {
+        int cpu = sched_getcpu();
+        reader_slot = (cpu < 0 ? 0 : cpu) % RW_SLOTS;
+    }
+    rw_slot_t *slot = &rw->slots[reader_slot];
+    int was_blocked = 0;
+    while (1) {
+        atomic_fetch_add(&slot->readers, 1);       // Count ourselves before looking at the flag
+        unsigned flag = atomic_load(&rw->wflag);
+        if (flag == 0) break;                      // No writer, the lock is ours
+        atomic_fetch_sub(&slot->readers, 1);       // Back off and let the writer drain
+        rwlock_wake_drain(rw);
+        if (!was_blocked) {
+            was_blocked = 1;
+            atomic_fetch_add(&rw->blocked, 1);     // Announce ourselves before sleeping
+        }
+        futex_wait(&rw->wflag, flag);
+    }
+    if (was_blocked && atomic_fetch_sub(&rw->blocked, 1) == 1 && rw->policy == RW_PHASE_FAIR) {
+        futex_wake(&rw->blocked, 1);               // The next writer waits for the last of us
+    }
+}
+
+// Release the read lock for readers
+void rwlock_release_readlock(rwlock_t *rw) {
+    atomic_fetch_sub(&rw->slots[reader_slot].readers, 1);
+    rwlock_wake_drain(rw);
+}
+
+
+//WRITER HELPER FUNCTIONS
+// Log writer activity to the output file
+void log_writer_activity(long num_readers) {
+    // Log writer activity to output file with synchronized access
+    pthread_mutex_lock(&output_lock);
+    fprintf(output_file, "Writing,Number-of-readers-present:[%ld]\n", num_readers);
+    fflush(output_file);
+    pthread_mutex_unlock(&output_lock);
+}
+
+// Writer operation: writes to the shared file
+void perform_write() {
+    // Append a line to the shared file; O_APPEND puts it at the end
+    static const char line[] = "Hello world!\n";
+    if (write(shared_fd, line, sizeof(line) - 1) < 0) {
+        perror("Failed to write shared file");
+    }
+}
+
+// Waits until no reader holds the lock, sleeping between scans.
+static void rwlock_wait_drain(rwlock_t *rw) {
+    while (1) {
+        unsigned seq = atomic_load(&rw->drain_seq);  // Read before the scan, so a wake-up is not missed
+        atomic_store(&rw->drain_waiting, 1);
+        if (rwlock_count_readers(rw) == 0) break;
+        futex_wait(&rw->drain_seq, seq);
+    }
+    atomic_store(&rw->drain_waiting, 0);
+}
+
+// Wakes every reader sleeping on the flag, if any announced itself.
+static void rwlock_wake_readers(rwlock_t *rw) {
+    if (atomic_load(&rw->blocked) > 0) {
+        futex_wake(&rw->wflag, INT_MAX);
+    }
+}
+
+// Acquire the write lock for writers
+void rwlock_acquire_writelock(rwlock_t *rw) {
+    switch (rw->policy) {
+    case RW_READER_PREF:
+        pthread_mutex_lock(&rw->writelock);
+        while (1) {
+            rwlock_wait_drain(rw);                 // Readers come and go freely meanwhile
+            atomic_store(&rw->wflag, 1);
+            if (rwlock_count_readers(rw) == 0) break;
+            atomic_store(&rw->wflag, 0);           // A reader got in first, let it have the lock
+            rwlock_wake_readers(rw);
+        }
+        break;
+    case RW_WRITER_PREF:
+        atomic_fetch_add(&rw->wflag, 1);           // Hold back new readers while we wait
+        pthread_mutex_lock(&rw->writelock);
+        rwlock_wait_drain(rw);
+        break;
+    case RW_PHASE_FAIR:
+        pthread_mutex_lock(&rw->writelock);
+        unsigned waiting;
+        while ((waiting = atomic_load(&rw->blocked)) != 0) {
+            futex_wait(&rw->blocked, waiting);     // Readers held back by the last writer go first
+        }
+        atomic_store(&rw->wflag, 1);
+        rwlock_wait_drain(rw);
+        break;
+    }
+}
+
+// Release the write lock for writers
+void rwlock_release_writelock(rwlock_t *rw) {
+    if (rw->policy == RW_WRITER_PREF) {
+        pthread_mutex_unlock(&rw->writelock);
+        if (atomic_fetch_sub(&rw->wflag, 1) == 1) {  // Readers wait until the last writer is done
+            rwlock_wake_readers(rw);
+        }
+    } else {
+        atomic_store(&rw->wflag, 0);
+        rwlock_wake_readers(rw);
+        pthread_mutex_unlock(&rw->writelock);
+    }
+}
+
+
+// Benchmark harness, built on the lock and file functions above
+#include "rwlock-bench.h"
+
+
+//MAIN READER FUNCTION
+// Reader thread function
+void *reader(void *arg) {
+    // Acquire read lock for safe reading
+    rwlock_acquire_readlock(&rwlock);
+
+    // Log reader activity to output file
+    log_reader_activity(rwlock_count_readers(&rwlock));
+
+    // Perform the read operation
+    perform_read();
+
+    // Release the read lock after finishing reading
+    rwlock_release_readlock(&rwlock);
+    return NULL;
+}
+
+
+//MAIN WRITER FUNCTION
+// Writer thread function
+void *writer(void *arg) {
+    // Acquire write lock to ensure exclusive access for writing
+    rwlock_acquire_writelock(&rwlock);
+
+    // Log writer activity to output file
+    log_writer_activity(rwlock_count_readers(&rwlock));
+
+    // Perform the write operation
+    perform_write();
+
+    // Release the write lock after finishing writing
+    rwlock_release_writelock(&rwlock);
+    return NULL;
+}
+
+
+// Main function
+int main(int argc, char **argv) {
+    // Benchmark every policy in turn with --bench
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        bench_config_t config = parse_bench_args(argc - 2, argv + 2);
+        const char *names[] = {"reader", "writer", "phase-fair"};
+        for (int p = RW_READER_PREF; p <= RW_PHASE_FAIR; p++) {
+            initialize_rwlock(&rwlock, p);
+            run_rwlock_bench(names[p], &config);
+            pthread_mutex_destroy(&rwlock.writelock);
+            close(shared_fd);
+        }
+        return 0;
+    }
+
+    if (argc != 3 && argc != 4) return 1;
+    int n = atoi(argv[1]);
+    int m = atoi(argv[2]);
+
+    // Pick the policy, writer preference unless another is named
+    rw_policy_t policy = RW_WRITER_PREF;
+    if (argc == 4) {
+        if (strcmp(argv[3], "reader") == 0) policy = RW_READER_PREF;
+        else if (strcmp(argv[3], "writer") == 0) policy = RW_WRITER_PREF;
+        else if (strcmp(argv[3], "phase-fair") == 0) policy = RW_PHASE_FAIR;
+        else return 1;
+    }
+
+    // Perform initialization of locks, files, and other resources
+    initialize_rwlock(&rwlock, policy);
+    open_output_file();
+
+    pthread_t readers[n], writers[m];
+
+    // Create reader and writer threads
+    for (int i = 0; i < n; i++) pthread_create(&readers[i], NULL, reader, NULL);
+    for (int i = 0; i < m; i++) pthread_create(&writers[i], NULL, writer, NULL);
+
+    // Wait for all threads to complete
+    for (int i = 0; i < n; i++) pthread_join(readers[i], NULL);
+    for (int i = 0; i < m; i++) pthread_join(writers[i], NULL);
+
+    // Close the output file after all operations are complete
+    fclose(output_file);
+    close(shared_fd);
+    return 0;
+}
@@ -1,11 +1,15 @@
 // rwlock-writer-pref.c
 // A Reader-Writer Lock with Writer Preference implementation
+// Run with --bench to measure steady-state throughput and acquire latency (see rwlock-bench.h)
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 // Define the Reader-Writer lock structure with writer preference
 typedef struct _rwlock_t {
@@ -19,11 +23,21 @@ typedef struct _rwlock_t {
 // Global variables
 rwlock_t rwlock;        // Instance of reader-writer lock
 FILE *output_file;      // File pointer for logging output
+int shared_fd = -1;    // Shared file, held open for every operation
 sem_t output_lock;      // Semaphore for exclusive access to the output file
 
 
 //INITIALISATION FUNCTION
-// Initialize the reader-writer lock and output file
+// Open the shared file for reading and appending, keeping it open for the whole run
+void open_shared_file() {
+    shared_fd = open("shared-file.txt", O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (shared_fd == -1) {
+        perror("Failed to open shared file");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Initialize the reader-writer lock and shared file
 void initialize_rwlock(rwlock_t *rw) {
     // Initialize the reader and writer counts
     rw->readers = 0;
@@ -37,7 +51,13 @@ void initialize_rwlock(rwlock_t *rw) {
     // Initialize the output file lock
     sem_init(&output_lock, 0, 1);
 
-    // Open the output file to log activities
+
+    // Open the shared file once; every read and write goes through this descriptor
+    open_shared_file();
+}
+
+// Open the output file to log activities
+void open_output_file() {
     output_file = fopen("output-writer-pref.txt", "w");
     if (output_file == NULL) {
         perror("Failed to open output file");  // Print error message if file opening fails
@@ -57,11 +77,10 @@ void log_reader_activity(int num_readers) {
 
 // Reader operation: reads the shared file
 void perform_read() {
-    // Open the shared file to read contents (simulating the read operation)
-    FILE *shared_file = fopen("shared-file.txt", "r");
-    if (shared_file != NULL) {
-        // Perform a read operation (e.g., read contents here, if needed)
-        fclose(shared_file);  // Close file after reading
+    // Read the start of the shared file through the open descriptor
+    char contents[256];
+    if (pread(shared_fd, contents, sizeof(contents), 0) < 0) {
+        perror("Failed to read shared file");
     }
 }
 
@@ -99,11 +118,10 @@ void log_writer_activity(int num_readers) {
 
 // Writer operation: writes to the shared file
 void perform_write() {
-    // Open the shared file to append contents (simulating the write operation)
-    FILE *shared_file = fopen("shared-file.txt", "a");
-    if (shared_file != NULL) {
-        fprintf(shared_file, "Hello world!\n");  // Append a line to the shared file
-        fclose(shared_file);                     // Close file after writing
+    // Append a line to the shared file; O_APPEND puts it at the end
+    static const char line[] = "Hello world!\n";
+    if (write(shared_fd, line, sizeof(line) - 1) < 0) {
+        perror("Failed to write shared file");
     }
 }
 
@@ -111,10 +129,12 @@ void perform_write() {
 void rwlock_acquire_writelock(rwlock_t *rw) {
     sem_wait(&rw->lock);           // Protect writers count increment
     rw->writers++;
-    if (rw->writers == 1) {        // If this is the first writer waiting
+    int first = rw->writers == 1;  // If this is the first writer waiting
+    sem_post(&rw->lock);           // Release access to writers count
+    if (first) {
+        // Waited for without rw->lock held: a reader takes rw->lock while holding readlock
         sem_wait(&rw->readlock);    // Block new readers from entering
     }
-    sem_post(&rw->lock);           // Release access to writers count
     sem_wait(&rw->writelock);      // Wait for exclusive write access
 }
 
@@ -129,6 +149,10 @@ void rwlock_release_writelock(rwlock_t *rw) {
     sem_post(&rw->lock);           // Release access to writers count
 }
 
+// Benchmark harness, built on the lock and file functions above
+#include "rwlock-bench.h"
+
+
 //MAIN READER FUNCTION
 // Reader thread function: executes read operation and logs activity
 void *reader(void *arg) {
@@ -174,6 +198,15 @@ void *writer(void *arg) {
 
 // Main function
 int main(int argc, char **argv) {
+    // Benchmark the lock instead with --bench [threads] [seconds] [read-percent] [cs-iterations]
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        bench_config_t config = parse_bench_args(argc - 2, argv + 2);
+        initialize_rwlock(&rwlock);
+        run_rwlock_bench("writer-pref", &config);
+        close(shared_fd);
+        return 0;
+    }
+
     // Check command-line arguments for reader and writer count
     if (argc != 3) return 1;
     int n = atoi(argv[1]);
@@ -181,6 +214,7 @@ int main(int argc, char **argv) {
 
     // Initialize the reader-writer lock and output file
     initialize_rwlock(&rwlock);
+    open_output_file();
 
     pthread_t readers[n], writers[m];
 
@@ -194,5 +228,6 @@ int main(int argc, char **argv) {
 
     // Close the output file after all threads complete
     fclose(output_file);
+    close(shared_fd);
     return 0;
 }